@@ -49,6 +49,8 @@ static PLI_INT32 my_mcd_printf(PLI_UINT32 mcd, const char *fmt, ...)
 
 struct timeformat_info_s timeformat_info = { 0, 0, 0, 20 };
 
+void (*sys_dumptrigger_hook)(void) = 0;
+
 struct strobe_cb_info {
       char*name;
       char*filename;
@@ -1941,6 +1943,12 @@ static PLI_INT32 sys_severity_calltf(PLI_BYTE8*name)
       free(info.items);
       free(dstr);
 
+	/* Errors are what a dump window is waiting for. */
+      if (sys_dumptrigger_hook && (strncmp(name,"$error",6) == 0 ||
+                                   strncmp(name,"$fatal",6) == 0)) {
+	    sys_dumptrigger_hook();
+      }
+
       if (strncmp(name,"$fatal",6) == 0) {
             vpi_control(vpiFinish, finish_number.value.integer);
       }
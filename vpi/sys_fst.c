@@ -52,6 +52,7 @@ static int dump_is_off = 0;
 static long dump_limit = 0;
 static int dump_is_full = 0;
 static int finish_status = 0;
+static PLI_UINT64 dump_window = 0; /* $dumpwindow width, 0 for none */
 
 
 static enum lxm_optimum_mode_e {
@@ -78,11 +79,15 @@ static void show_this_item(struct vcd_info*info)
       if (type == vpiRealVar) {
 	    value.format = vpiRealVal;
 	    vpi_get_value(info->item, &value);
-	    fstWriterEmitValueChange(dump_file, info->handle, &value.value.real);
+	    vcd_work_emit_fst_double(info->handle, value.value.real);
       } else {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    fstWriterEmitValueChange(dump_file, info->handle, value.value.str);
+	    const char*bits = vcd_get_bits(info->item);
+	    if (bits == 0) {
+		  value.format = vpiBinStrVal;
+		  vpi_get_value(info->item, &value);
+		  bits = value.value.str;
+	    }
+	    vcd_work_emit_fst_bits(info->handle, bits);
       }
 }
 
@@ -94,14 +99,15 @@ static void show_this_item_x(struct vcd_info*info)
       if (type == vpiRealVar) {
 	      /* Some tools dump nothing here...? */
             double mynan = strtod("NaN", NULL);
-	    fstWriterEmitValueChange(dump_file, info->handle, &mynan);
+	    vcd_work_emit_fst_double(info->handle, mynan);
       } else if (type == vpiNamedEvent) {
 	    /* Do nothing for named events. */
       } else {
 	    int siz = vpi_get(vpiSize, info->item);
-	    char *xmem = malloc(siz);
+	    char *xmem = malloc(siz+1);
 	    memset(xmem, 'x', siz);
-	    fstWriterEmitValueChange(dump_file, info->handle, xmem);
+	    xmem[siz] = 0;
+	    vcd_work_emit_fst_bits(info->handle, xmem);
 	    free(xmem);
       }
 }
@@ -142,13 +148,43 @@ static void vcd_checkpoint_x()
 	    show_this_item_x(cur);
 }
 
+/*
+ * In $dumpwindow mode, start a new window segment with a checkpoint of
+ * all the dumped values. The checkpoint of the oldest segment becomes
+ * the initial values when the window is written out.
+ */
+static void window_checkpoint(PLI_UINT64 now)
+{
+      vcd_work_window_checkpoint(now);
+      if (!dump_is_off) {
+	    vcd_work_emit_time(now);
+	    vcd_checkpoint();
+      }
+      vcd_work_window_body();
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       struct vcd_info* info = vcd_dmp_list;
       PLI_UINT64 now = timerec_to_time64(cause->time);
 
       if (now != vcd_cur_time) {
-	    fstWriterEmitTimeChange(dump_file, now);
+	      /* The work thread owns the writer, so only look at the
+		 limit once it has caught up, at each new time step. */
+	    if (dump_limit > 0) {
+		  vcd_work_sync();
+		  if (fstWriterGetDumpSizeLimitReached(dump_file)) {
+			dump_is_full = 1;
+			vpi_printf("WARNING: Dump file limit (%ld bytes) "
+				   "exceeded.\n", dump_limit);
+			for ( ; info ; info = info->dmp_next)
+			      info->scheduled = 0;
+			vcd_dmp_list = 0;
+			return 0;
+		  }
+	    }
+	    if (vcd_work_window_due(now)) window_checkpoint(now);
+	    vcd_work_emit_time(now);
 	    vcd_cur_time = now;
       }
 
@@ -172,13 +208,6 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       if (dump_header_pending()) return 0;
       if (info->scheduled) return 0;
 
-      if ((dump_limit > 0) && fstWriterGetDumpSizeLimitReached(dump_file)) {
-            dump_is_full = 1;
-            vpi_printf("WARNING: Dump file limit (%ld bytes) "
-                               "exceeded.\n", dump_limit);
-            return 0;
-      }
-
       if (!vcd_dmp_list) {
           cb = *cause;
           cb.reason = cbReadOnlySynch;
@@ -193,6 +222,56 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       return 0;
 }
 
+/*
+ * This is the FST work thread. It makes the writer calls for the
+ * value changes and other commands that the simulation sends through
+ * the work queue, so the compression and the disk writes happen
+ * here and not in the simulation thread.
+ */
+static void* fst_thread(void*arg)
+{
+      int run_flag = 1;
+      while (run_flag) {
+	    struct vcd_work_item_s*cell = vcd_work_thread_peek();
+
+	    switch (cell->type) {
+		case WT_NONE:
+		case WT_WINDOW_CHECKPOINT: /* The work queue takes these. */
+		case WT_WINDOW_BODY:
+		case WT_WINDOW_TRIGGER:
+		case WT_EMIT_TEXT:
+		  break;
+		case WT_FLUSH:
+		  fstWriterFlushContext(dump_file);
+		  break;
+		case WT_DUMPON:
+		  fstWriterEmitDumpActive(dump_file, 1); /* $dumpon */
+		  break;
+		case WT_DUMPOFF:
+		  fstWriterEmitDumpActive(dump_file, 0); /* $dumpoff */
+		  break;
+		case WT_EMIT_TIME:
+		  fstWriterEmitTimeChange(dump_file, cell->time);
+		  break;
+		case WT_EMIT_DOUBLE:
+		  fstWriterEmitValueChange(dump_file, cell->sym_.fst,
+					   &cell->op_.val_double);
+		  break;
+		case WT_EMIT_BITS:
+		  fstWriterEmitValueChange(dump_file, cell->sym_.fst,
+					   cell->op_.val_char);
+		  break;
+		case WT_TERMINATE:
+		  run_flag = 0;
+		  break;
+	    }
+
+	    vcd_work_thread_pop();
+      }
+
+      return 0;
+}
+
 static PLI_INT32 dumpvars_cb(p_cb_data cause)
 {
       if (dumpvars_status != 1) return 0;
@@ -204,8 +283,16 @@ static PLI_INT32 dumpvars_cb(p_cb_data cause)
 
       /* nothing to do for $enddefinitions $end */
 
-      if (!dump_is_off) {
-	    fstWriterEmitTimeChange(dump_file, dumpvars_time);
+	/* The header is complete, so from here on the work thread
+	   makes all the writer calls. */
+      vcd_work_start(fst_thread, 0);
+
+      if (dump_window > 0) {
+	    vcd_work_window(dump_window);
+	    window_checkpoint(dumpvars_time);
+
+      } else if (!dump_is_off) {
+	    vcd_work_emit_time(dumpvars_time);
 	    /* nothing to do for  $dumpvars... */
 	    vcd_checkpoint();
 	    /* ...nothing to do for $end */
@@ -225,9 +312,16 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       dumpvars_time = timerec_to_time64(cause->time);
 
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
-	    fstWriterEmitTimeChange(dump_file, dumpvars_time);
+	    vcd_work_emit_time(dumpvars_time);
       }
 
+      if (vcd_work_window_active()) {
+	    vpi_printf("FST info: $dumpwindow was never triggered, "
+	               "no values were dumped.\n");
+      }
+      sys_dumptrigger_hook = 0;
+
+      vcd_work_terminate();
       fstWriterClose(dump_file);
 
       for (cur = vcd_list ;  cur ;  cur = next) {
@@ -293,11 +387,11 @@ static PLI_INT32 sys_dumpoff_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fstWriterEmitTimeChange(dump_file, now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fstWriterEmitDumpActive(dump_file, 0); /* $dumpoff */
+      vcd_work_dumpoff();
       vcd_checkpoint_x();
 
       return 0;
@@ -320,11 +414,11 @@ static PLI_INT32 sys_dumpon_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fstWriterEmitTimeChange(dump_file, now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fstWriterEmitDumpActive(dump_file, 1); /* $dumpon */
+      vcd_work_dumpon();
       vcd_checkpoint();
 
       return 0;
@@ -344,7 +438,7 @@ static PLI_INT32 sys_dumpall_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fstWriterEmitTimeChange(dump_file, now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
@@ -441,7 +535,15 @@ static PLI_INT32 sys_dumpfile_calltf(PLI_BYTE8*name)
 
 static PLI_INT32 sys_dumpflush_calltf(PLI_BYTE8*name)
 {
-      if (dump_file) fstWriterFlushContext(dump_file);
+      if (dump_file == 0) return 0;
+
+      if (dump_header_pending()) fstWriterFlushContext(dump_file);
+      else {
+	      /* Wait for the work thread so the file is up to date
+	         when $dumpflush returns. */
+	    vcd_work_flush();
+	    vcd_work_sync();
+      }
 
       return 0;
 }
@@ -456,12 +558,57 @@ static PLI_INT32 sys_dumplimit_calltf(PLI_BYTE8 *name)
       val.format = vpiIntVal;
       vpi_get_value(vpi_scan(argv), &val);
       dump_limit = val.value.integer;
+	/* The work thread may be using the writer. */
+      vcd_work_sync();
       fstWriterSetDumpSizeLimit(dump_file, dump_limit);
 
       vpi_free_object(argv);
       return 0;
 }
 
+/*
+ * This is the trigger for a $dumpwindow. It is called by $dumptrigger
+ * and, through sys_dumptrigger_hook, by $error and $fatal.
+ */
+static void dump_trigger(void)
+{
+      sys_dumptrigger_hook = 0;
+
+	/* If the window has not started yet, just dump everything. */
+      if (dump_header_pending()) {
+	    dump_window = 0;
+	    return;
+      }
+
+      if (vcd_work_window_trigger())
+	    vpi_printf("FST info: dump window triggered, writing it out.\n");
+}
+
+static PLI_INT32 sys_dumpwindow_calltf(PLI_BYTE8 *name)
+{
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+
+      if (dumpvars_status == 2) {
+	    vpi_printf("FST warning: %s:%d: ", vpi_get_str(vpiFile, callh),
+	               (int)vpi_get(vpiLineNo, callh));
+	    vpi_printf("%s ignored, it must be called before $dumpvars "
+	               "starts.\n", name);
+	    return 0;
+      }
+
+      dump_window = vcd_get_window_width(callh);
+      sys_dumptrigger_hook = dump_trigger;
+
+      return 0;
+}
+
+static PLI_INT32 sys_dumptrigger_calltf(PLI_BYTE8 *name)
+{
+      if (sys_dumptrigger_hook == dump_trigger) dump_trigger();
+
+      return 0;
+}
+
 static void scan_item(unsigned depth, vpiHandle item, int skip)
 {
       struct t_cb_data cb;
@@ -892,6 +1039,15 @@ void sys_fst_register()
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumptrigger";
+      tf_data.calltf    = sys_dumptrigger_calltf;
+      tf_data.compiletf = sys_no_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumptrigger";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$dumpvars";
       tf_data.calltf    = sys_dumpvars_calltf;
@@ -900,4 +1056,13 @@ void sys_fst_register()
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumpwindow";
+      tf_data.calltf    = sys_dumpwindow_calltf;
+      tf_data.compiletf = sys_one_numeric_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumpwindow";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
 }
@@ -168,11 +168,14 @@ static void show_this_item(struct vcd_info*info)
 	    lt_emit_value_double(dump_file, info->sym, 0, value.value.real);
 
       } else {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
+	    char*bits = (char*)vcd_get_bits(info->item);
+	    if (bits == 0) {
+		  value.format = vpiBinStrVal;
+		  vpi_get_value(info->item, &value);
+		  bits = value.value.str;
+	    }
 	    lt_emit_value_bit_string(dump_file, info->sym,
-	                             0 /* array row */,
-	                             value.value.str);
+	                             0 /* array row */, bits);
       }
 }
 
@@ -846,6 +849,15 @@ void sys_lxt_register()
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumptrigger";
+      tf_data.calltf    = sys_dumpwindow_ignored_calltf;
+      tf_data.compiletf = sys_no_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumptrigger";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$dumpvars";
       tf_data.calltf    = sys_dumpvars_calltf;
@@ -854,4 +866,13 @@ void sys_lxt_register()
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumpwindow";
+      tf_data.calltf    = sys_dumpwindow_ignored_calltf;
+      tf_data.compiletf = sys_one_numeric_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumpwindow";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
 }
@@ -225,9 +225,13 @@ static void show_this_item(struct vcd_info*info)
 	    vcd_work_emit_double(info->sym, value.value.real);
 
       } else {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    vcd_work_emit_bits(info->sym, value.value.str);
+	    const char*bits = vcd_get_bits(info->item);
+	    if (bits == 0) {
+		  value.format = vpiBinStrVal;
+		  vpi_get_value(info->item, &value);
+		  bits = value.value.str;
+	    }
+	    vcd_work_emit_bits(info->sym, bits);
       }
 }
 
@@ -838,6 +842,11 @@ static void* lxt2_thread(void*arg)
 
 	    switch (cell->type) {
 		case WT_NONE:
+		case WT_WINDOW_CHECKPOINT: /* The work queue takes these. */
+		case WT_WINDOW_BODY:
+		case WT_WINDOW_TRIGGER:
+		case WT_EMIT_TIME: /* The item time does this. */
+		case WT_EMIT_TEXT:
 		  break;
 		case WT_FLUSH:
 		  lxt2_wr_flush(dump_file);
@@ -950,6 +959,15 @@ void sys_lxt2_register()
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumptrigger";
+      tf_data.calltf    = sys_dumpwindow_ignored_calltf;
+      tf_data.compiletf = sys_no_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumptrigger";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$dumpvars";
       tf_data.calltf    = sys_dumpvars_calltf;
@@ -958,4 +976,13 @@ void sys_lxt2_register()
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumpwindow";
+      tf_data.calltf    = sys_dumpwindow_ignored_calltf;
+      tf_data.compiletf = sys_one_numeric_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumpwindow";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
 }
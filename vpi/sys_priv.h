@@ -50,6 +50,12 @@ struct timeformat_info_s {
 
 extern struct timeformat_info_s timeformat_info;
 
+/*
+ * A dumper that is holding a $dumpwindow sets this to its trigger, so
+ * that $error and $fatal can write the window out. It is 0 otherwise.
+ */
+extern void (*sys_dumptrigger_hook)(void);
+
 extern unsigned is_constant_obj(vpiHandle obj);
 extern unsigned is_numeric_obj(vpiHandle obj);
 extern unsigned is_string_obj(vpiHandle obj);
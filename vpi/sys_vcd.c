@@ -51,6 +51,7 @@ static int dump_is_off = 0;
 static long dump_limit = 0;
 static int dump_is_full = 0;
 static int finish_status = 0;
+static PLI_UINT64 dump_window = 0; /* $dumpwindow width, 0 for none */
 
 
 static const char*units_names[] = {
@@ -95,6 +96,11 @@ static char *truncate_bitvec(char *s)
       }
 }
 
+/*
+ * The value changes are sent to the VCD work thread, which does the
+ * formatting and the writing (see vcd_thread below). The simulation
+ * thread only captures the value.
+ */
 static void show_this_item(struct vcd_info*info)
 {
       s_vpi_value value;
@@ -103,18 +109,17 @@ static void show_this_item(struct vcd_info*info)
       if (type == vpiRealVar) {
 	    value.format = vpiRealVal;
 	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "r%.16g %s\n", value.value.real, info->ident);
+	    vcd_work_emit_vcd_double(info->ident, value.value.real);
       } else if (type == vpiNamedEvent) {
-	    fprintf(dump_file, "1%s\n", info->ident);
-      } else if (vpi_get(vpiSize, info->item) == 1) {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "%s%s\n", value.value.str, info->ident);
+	    vcd_work_emit_vcd_bits(info->ident, "1");
       } else {
-	    value.format = vpiBinStrVal;
-	    vpi_get_value(info->item, &value);
-	    fprintf(dump_file, "b%s %s\n", truncate_bitvec(value.value.str),
-		    info->ident);
+	    const char*bits = vcd_get_bits(info->item);
+	    if (bits == 0) {
+		  value.format = vpiBinStrVal;
+		  vpi_get_value(info->item, &value);
+		  bits = value.value.str;
+	    }
+	    vcd_work_emit_vcd_bits(info->ident, bits);
       }
 }
 
@@ -122,17 +127,20 @@ static void show_this_item(struct vcd_info*info)
 static void show_this_item_x(struct vcd_info*info)
 {
       PLI_INT32 type = vpi_get(vpiType, info->item);
+      char buf[64];
 
       if (type == vpiRealVar) {
 	      /* Some tools dump nothing here...? */
-	    fprintf(dump_file, "rNaN %s\n", info->ident);
+	    snprintf(buf, sizeof buf, "rNaN %s\n", info->ident);
       } else if (type == vpiNamedEvent) {
 	    /* Do nothing for named events. */
+	    return;
       } else if (vpi_get(vpiSize, info->item) == 1) {
-	    fprintf(dump_file, "x%s\n", info->ident);
+	    snprintf(buf, sizeof buf, "x%s\n", info->ident);
       } else {
-	    fprintf(dump_file, "bx %s\n", info->ident);
+	    snprintf(buf, sizeof buf, "bx %s\n", info->ident);
       }
+      vcd_work_emit_text(buf);
 }
 
 
@@ -171,13 +179,31 @@ static void vcd_checkpoint_x()
 	    show_this_item_x(cur);
 }
 
+/*
+ * In $dumpwindow mode, start a new window segment with a checkpoint of
+ * all the dumped values. The checkpoint of the oldest segment becomes
+ * the $dumpvars section when the window is written out.
+ */
+static void window_checkpoint(PLI_UINT64 now)
+{
+      vcd_work_window_checkpoint(now);
+      if (!dump_is_off) {
+	    vcd_work_emit_time(now);
+	    vcd_work_emit_text("$dumpvars\n");
+	    vcd_checkpoint();
+	    vcd_work_emit_text("$end\n");
+      }
+      vcd_work_window_body();
+}
+
 static PLI_INT32 variable_cb_2(p_cb_data cause)
 {
       struct vcd_info* info = vcd_dmp_list;
       PLI_UINT64 now = timerec_to_time64(cause->time);
 
       if (now != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now);
+	    if (vcd_work_window_due(now)) window_checkpoint(now);
+	    vcd_work_emit_time(now);
 	    vcd_cur_time = now;
       }
 
@@ -201,12 +227,16 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       if (dump_header_pending()) return 0;
       if (info->scheduled) return 0;
 
+	/* The file position trails the values still in the work
+	   queue, so the limit may be overshot by that much. */
       if ((dump_limit > 0) && (ftell(dump_file) > dump_limit)) {
+	    char buf[80];
             dump_is_full = 1;
             vpi_printf("WARNING: Dump file limit (%ld bytes) "
                                "exceeded.\n", dump_limit);
-            fprintf(dump_file, "$comment Dump file limit (%ld bytes) "
-                               "exceeded. $end\n", dump_limit);
+	    snprintf(buf, sizeof buf, "$comment Dump file limit (%ld bytes) "
+		     "exceeded. $end\n", dump_limit);
+	    vcd_work_emit_text(buf);
             return 0;
       }
 
@@ -224,6 +254,59 @@ static PLI_INT32 variable_cb_1(p_cb_data cause)
       return 0;
 }
 
+/*
+ * This is the VCD work thread. It takes the value changes and other
+ * commands that the simulation sends through the work queue, and
+ * formats and writes them to the dump file.
+ */
+static void* vcd_thread(void*arg)
+{
+      int run_flag = 1;
+      while (run_flag) {
+	    struct vcd_work_item_s*cell = vcd_work_thread_peek();
+	    char*bits;
+
+	    switch (cell->type) {
+		case WT_NONE:
+		case WT_WINDOW_CHECKPOINT: /* The work queue takes these. */
+		case WT_WINDOW_BODY:
+		case WT_WINDOW_TRIGGER:
+		case WT_DUMPON: /* These are sent as text. */
+		case WT_DUMPOFF:
+		  break;
+		case WT_FLUSH:
+		  fflush(dump_file);
+		  break;
+		case WT_EMIT_TIME:
+		  fprintf(dump_file, "#%" PLI_UINT64_FMT "\n",
+			  (PLI_UINT64)cell->time);
+		  break;
+		case WT_EMIT_TEXT:
+		  fputs(cell->op_.val_char, dump_file);
+		  break;
+		case WT_EMIT_DOUBLE:
+		  fprintf(dump_file, "r%.16g %s\n", cell->op_.val_double,
+			  cell->sym_.vcd);
+		  break;
+		case WT_EMIT_BITS:
+		  bits = cell->op_.val_char;
+		  if (bits[0] != 0 && bits[1] == 0)
+			fprintf(dump_file, "%s%s\n", bits, cell->sym_.vcd);
+		  else
+			fprintf(dump_file, "b%s %s\n", truncate_bitvec(bits),
+				cell->sym_.vcd);
+		  break;
+		case WT_TERMINATE:
+		  run_flag = 0;
+		  break;
+	    }
+
+	    vcd_work_thread_pop();
+      }
+
+      return 0;
+}
+
 static PLI_INT32 dumpvars_cb(p_cb_data cause)
 {
       if (dumpvars_status != 1) return 0;
@@ -235,11 +318,19 @@ static PLI_INT32 dumpvars_cb(p_cb_data cause)
 
       fprintf(dump_file, "$enddefinitions $end\n");
 
-      if (!dump_is_off) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
-	    fprintf(dump_file, "$dumpvars\n");
+	/* The header is complete, so from here on the work thread
+	   does all the writing. */
+      vcd_work_start(vcd_thread, 0);
+
+      if (dump_window > 0) {
+	    vcd_work_window(dump_window);
+	    window_checkpoint(dumpvars_time);
+
+      } else if (!dump_is_off) {
+	    vcd_work_emit_time(dumpvars_time);
+	    vcd_work_emit_text("$dumpvars\n");
 	    vcd_checkpoint();
-	    fprintf(dump_file, "$end\n");
+	    vcd_work_emit_text("$end\n");
       }
 
       return 0;
@@ -256,9 +347,16 @@ static PLI_INT32 finish_cb(p_cb_data cause)
       dumpvars_time = timerec_to_time64(cause->time);
 
       if (!dump_is_off && !dump_is_full && dumpvars_time != vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", dumpvars_time);
+	    vcd_work_emit_time(dumpvars_time);
+      }
+
+      if (vcd_work_window_active()) {
+	    vpi_printf("VCD info: $dumpwindow was never triggered, "
+	               "no values were dumped.\n");
       }
+      sys_dumptrigger_hook = 0;
 
+      vcd_work_terminate();
       fclose(dump_file);
 
       for (cur = vcd_list ;  cur ;  cur = next) {
@@ -325,13 +423,13 @@ static PLI_INT32 sys_dumpoff_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpoff\n");
+      vcd_work_emit_text("$dumpoff\n");
       vcd_checkpoint_x();
-      fprintf(dump_file, "$end\n");
+      vcd_work_emit_text("$end\n");
 
       return 0;
 }
@@ -353,13 +451,13 @@ static PLI_INT32 sys_dumpon_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpon\n");
+      vcd_work_emit_text("$dumpon\n");
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      vcd_work_emit_text("$end\n");
 
       return 0;
 }
@@ -378,13 +476,13 @@ static PLI_INT32 sys_dumpall_calltf(PLI_BYTE8*name)
       now64 = timerec_to_time64(&now);
 
       if (now64 > vcd_cur_time) {
-	    fprintf(dump_file, "#%" PLI_UINT64_FMT "\n", now64);
+	    vcd_work_emit_time(now64);
 	    vcd_cur_time = now64;
       }
 
-      fprintf(dump_file, "$dumpall\n");
+      vcd_work_emit_text("$dumpall\n");
       vcd_checkpoint();
-      fprintf(dump_file, "$end\n");
+      vcd_work_emit_text("$end\n");
 
       return 0;
 }
@@ -470,7 +568,15 @@ static PLI_INT32 sys_dumpfile_calltf(PLI_BYTE8*name)
 
 static PLI_INT32 sys_dumpflush_calltf(PLI_BYTE8*name)
 {
-      if (dump_file) fflush(dump_file);
+      if (dump_file == 0) return 0;
+
+      if (dump_header_pending()) fflush(dump_file);
+      else {
+	      /* Wait for the work thread so the file is up to date
+	         when $dumpflush returns. */
+	    vcd_work_flush();
+	    vcd_work_sync();
+      }
 
       return 0;
 }
@@ -490,6 +596,49 @@ static PLI_INT32 sys_dumplimit_calltf(PLI_BYTE8 *name)
       return 0;
 }
 
+/*
+ * This is the trigger for a $dumpwindow. It is called by $dumptrigger
+ * and, through sys_dumptrigger_hook, by $error and $fatal.
+ */
+static void dump_trigger(void)
+{
+      sys_dumptrigger_hook = 0;
+
+	/* If the window has not started yet, just dump everything. */
+      if (dump_header_pending()) {
+	    dump_window = 0;
+	    return;
+      }
+
+      if (vcd_work_window_trigger())
+	    vpi_printf("VCD info: dump window triggered, writing it out.\n");
+}
+
+static PLI_INT32 sys_dumpwindow_calltf(PLI_BYTE8 *name)
+{
+      vpiHandle callh = vpi_handle(vpiSysTfCall, 0);
+
+      if (dumpvars_status == 2) {
+	    vpi_printf("VCD warning: %s:%d: ", vpi_get_str(vpiFile, callh),
+	               (int)vpi_get(vpiLineNo, callh));
+	    vpi_printf("%s ignored, it must be called before $dumpvars "
+	               "starts.\n", name);
+	    return 0;
+      }
+
+      dump_window = vcd_get_window_width(callh);
+      sys_dumptrigger_hook = dump_trigger;
+
+      return 0;
+}
+
+static PLI_INT32 sys_dumptrigger_calltf(PLI_BYTE8 *name)
+{
+      if (sys_dumptrigger_hook == dump_trigger) dump_trigger();
+
+      return 0;
+}
+
 static void scan_item(unsigned depth, vpiHandle item, int skip)
 {
       struct t_cb_data cb;
@@ -892,6 +1041,15 @@ void sys_vcd_register()
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
 
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumptrigger";
+      tf_data.calltf    = sys_dumptrigger_calltf;
+      tf_data.compiletf = sys_no_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumptrigger";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
+
       tf_data.type      = vpiSysTask;
       tf_data.tfname    = "$dumpvars";
       tf_data.calltf    = sys_dumpvars_calltf;
@@ -900,4 +1058,13 @@ void sys_vcd_register()
       tf_data.user_data = "$dumpvars";
       res = vpi_register_systf(&tf_data);
       vpip_make_systf_system_defined(res);
+
+      tf_data.type      = vpiSysTask;
+      tf_data.tfname    = "$dumpwindow";
+      tf_data.calltf    = sys_dumpwindow_calltf;
+      tf_data.compiletf = sys_one_numeric_arg_compiletf;
+      tf_data.sizetf    = 0;
+      tf_data.user_data = "$dumpwindow";
+      res = vpi_register_systf(&tf_data);
+      vpip_make_systf_system_defined(res);
 }
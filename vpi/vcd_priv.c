@@ -130,6 +130,94 @@ void vcd_names_sort(struct vcd_names_list_s*tab)
       }
 }
 
+/*
+ * Get the value of a vector item as a string of 0/1/z/x characters,
+ * most significant bit first, straight from the bits that
+ * vpip_get_planes gives. This is what the dumpers use instead of a
+ * vpiBinStrVal. If the item has no planes, this returns 0 and the
+ * caller must use vpi_get_value. The string is in a buffer that the
+ * next call reuses.
+ */
+const char* vcd_get_bits(vpiHandle item)
+{
+      static char*buf = 0;
+      static unsigned buf_size = 0;
+      static const char bit_chars[4] = { '0', '1', 'z', 'x' };
+      const unsigned bpw = 8*sizeof(unsigned long);
+      s_vpip_planes planes;
+      unsigned wid, idx;
+
+      if (! vpip_get_planes(item, &planes)) return 0;
+
+      wid = planes.size;
+      if (wid >= buf_size) {
+	    buf_size = wid + 1;
+	    buf = realloc(buf, buf_size);
+      }
+
+      for (idx = 0 ; idx < wid ; idx += bpw) {
+	    unsigned long a = planes.abits[idx/bpw];
+	    unsigned long b = planes.bbits[idx/bpw];
+	    unsigned cnt = wid - idx;
+	    char*cp = buf + wid - idx - 1;
+	    unsigned bdx;
+
+	    if (cnt > bpw) cnt = bpw;
+	    for (bdx = 0 ; bdx < cnt ; bdx += 1) {
+		  *cp-- = bit_chars[(a&1) | ((b&1)<<1)];
+		  a >>= 1;
+		  b >>= 1;
+	    }
+      }
+      buf[wid] = 0;
+
+      return buf;
+}
+
+/*
+ * Get the width argument of a $dumpwindow call, which is in the time
+ * units of the calling module, as a number of simulation ticks.
+ */
+PLI_UINT64 vcd_get_window_width(vpiHandle callh)
+{
+      vpiHandle argv = vpi_iterate(vpiArgument, callh);
+      vpiHandle mod = sys_func_module(callh);
+      int units = vpi_get(vpiTimeUnit, mod);
+      int prec = vpi_get(vpiTimePrecision, 0);
+      s_vpi_value val;
+      double width;
+
+      val.format = vpiRealVal;
+      vpi_get_value(vpi_scan(argv), &val);
+      vpi_free_object(argv);
+
+      width = val.value.real;
+      while (units > prec) {
+	    width *= 10.0;
+	    units -= 1;
+      }
+
+      if (width < 1.0) return 1;
+      return (PLI_UINT64)(width + 0.5);
+}
+
+/*
+ * The LXT and LXT2 dumpers do not support windowed dumping. They
+ * register this for $dumpwindow and $dumptrigger, and dump
+ * everything as usual.
+ */
+PLI_INT32 sys_dumpwindow_ignored_calltf(PLI_BYTE8*name)
+{
+      static int warned = 0;
+
+      if (! warned) {
+	    vpi_printf("WARNING: %s is only supported by the VCD and FST "
+	               "dumpers, dumping everything.\n", name);
+	    warned = 1;
+      }
+      return 0;
+}
+
 /*
  * Since the compiletf routines are all the same they are located here,
  * so we only need a single copy. Some are generic enough they can use
@@ -62,34 +62,55 @@ EXTERN void vcd_scope_names_add(const char*name);
 EXTERN int  vcd_scope_names_test(const char*name);
 EXTERN void vcd_scope_names_delete(void);
 
+EXTERN const char* vcd_get_bits(vpiHandle item);
+EXTERN PLI_UINT64 vcd_get_window_width(vpiHandle callh);
+
 /*
  * Implement a work queue that can be used to send commands to a
- * dumper thread.
+ * dumper thread. The simulation thread is the only producer and the
+ * dumper thread the only consumer, so the queue is a lock free ring
+ * and neither side blocks unless the ring is full or empty.
  */
 
 typedef enum vcd_work_item_type_e {
       WT_NONE,
       WT_EMIT_BITS,
       WT_EMIT_DOUBLE,
+      WT_EMIT_TIME,
+      WT_EMIT_TEXT,
       WT_DUMPON,
       WT_DUMPOFF,
       WT_FLUSH,
-      WT_TERMINATE
+      WT_TERMINATE,
+      WT_WINDOW_CHECKPOINT,
+      WT_WINDOW_BODY,
+      WT_WINDOW_TRIGGER
 } vcd_work_item_type_t;
 
 struct lxt2_wr_symbol;
 
+/*
+ * Values (and text) short enough to fit in val_buf are copied there,
+ * so the common case costs no heap allocation. Longer strings are
+ * copied to the heap and freed when the item is popped. Either way
+ * op_.val_char points at the string.
+ */
+# define VCD_WORK_VAL_BUF 40
+
 struct vcd_work_item_s {
       vcd_work_item_type_t type;
       uint64_t time;
       union {
 	    struct lxt2_wr_symbol*lxt2;
+	    const char*vcd;
+	    uint32_t fst;
       } sym_;
 
       union {
 	    double val_double;
 	    char*val_char;
       } op_;
+      char val_buf[VCD_WORK_VAL_BUF];
 };
 
 /*
@@ -108,7 +129,8 @@ EXTERN void vcd_work_thread_pop(void);
  * the work thread (gracefully) with the vcd_work_terminate
  * function. Synchronize with the work thread with the vcd_work_sync
  * function. This blocks until the work thread is done all the work it
- * has so far.
+ * has so far. Terminating a work thread that is not running does
+ * nothing.
  */
 EXTERN void vcd_work_start( void* (*fun) (void*arg), void*arg);
 EXTERN void vcd_work_terminate(void);
@@ -117,18 +139,50 @@ EXTERN void vcd_work_sync(void);
 
 /*
  * The remaining vcd_work_* functions send messages to the work thread
- * causing it to perform various VCD-related tasks.
+ * causing it to perform various VCD-related tasks. The set_time
+ * function only stamps the items that follow, where emit_time also
+ * sends an item so the work thread can write the time change even if
+ * nothing changes at that time. The value emitters come in a flavor
+ * for each kind of dumper symbol: LXT2 symbols, VCD identifiers and
+ * FST handles.
  */
 EXTERN void vcd_work_flush(void); /* Drain output caches. */
 EXTERN void vcd_work_set_time(uint64_t val);
+EXTERN void vcd_work_emit_time(uint64_t val);
+EXTERN void vcd_work_emit_text(const char*text);
 EXTERN void vcd_work_dumpon(void);
 EXTERN void vcd_work_dumpoff(void);
 EXTERN void vcd_work_emit_double(struct lxt2_wr_symbol*sym, double val);
 EXTERN void vcd_work_emit_bits(struct lxt2_wr_symbol*sym, const char*bits);
+EXTERN void vcd_work_emit_vcd_double(const char*ident, double val);
+EXTERN void vcd_work_emit_vcd_bits(const char*ident, const char*bits);
+EXTERN void vcd_work_emit_fst_double(uint32_t handle, double val);
+EXTERN void vcd_work_emit_fst_bits(uint32_t handle, const char*bits);
+
+/*
+ * Windowed dumping ($dumpwindow) keeps the last width ticks of value
+ * changes in memory in the work thread, and writes them out only when
+ * vcd_work_window_trigger is called. The window is made of segments
+ * that each start with a checkpoint. When vcd_work_window_due says
+ * so, the dumper calls vcd_work_window_checkpoint, sends the value of
+ * every dumped item as it would for $dumpvars, and then calls
+ * vcd_work_window_body before it sends the changes. The trigger
+ * returns 0 if there is no window to write, and otherwise ends window
+ * mode so the rest of the dump goes straight to the file.
+ */
+EXTERN void vcd_work_window(uint64_t width);
+EXTERN int  vcd_work_window_active(void);
+EXTERN int  vcd_work_window_due(uint64_t now);
+EXTERN void vcd_work_window_checkpoint(uint64_t now);
+EXTERN void vcd_work_window_body(void);
+EXTERN int  vcd_work_window_trigger(void);
 
 /* The compiletf routines are common for the VCD, LXT and LXT2 dumpers. */
 EXTERN PLI_INT32 sys_dumpvars_compiletf(PLI_BYTE8 *name);
 
+/* The LXT and LXT2 dumpers use this for $dumpwindow and $dumptrigger. */
+EXTERN PLI_INT32 sys_dumpwindow_ignored_calltf(PLI_BYTE8 *name);
+
 #undef EXTERN
 
 #endif
@@ -17,14 +17,20 @@
  *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 
+# include  "vpi_config.h"
 # include  "vcd_priv.h"
 # include  <map>
 # include  <set>
+# include  <deque>
+# include  <vector>
 # include  <string>
 # include  <pthread.h>
 # include  <cstdlib>
 # include  <cstring>
 # include  <cassert>
+#ifdef HAVE_LIBZ
+# include  <zlib.h>
+#endif
 
 /*
    Nexus Id cache
@@ -84,71 +90,386 @@ extern "C" void vcd_scope_names_delete(void)
 }
 
 static pthread_t work_thread;
+static bool work_thread_running = false;
 
 static const unsigned WORK_QUEUE_SIZE = 128*1024;
 static const unsigned WORK_QUEUE_BATCH_MIN = 4*1024;
 static const unsigned WORK_QUEUE_BATCH_MAX = 32*1024;
 
+/*
+ * The work queue is a ring with exactly one producer (the simulation
+ * thread) and one consumer (the work thread), so it needs no lock.
+ * Only the producer writes work_queue_tail and only the consumer
+ * writes work_queue_head. Both are free running counts: the slot for
+ * a count is the count modulo WORK_QUEUE_SIZE (a power of 2) and the
+ * fill is tail-head. Each side issues a barrier before it moves its
+ * index, so the other side never sees the index before the contents
+ * of the items it covers.
+ *
+ * A side that must wait (the consumer for an empty ring, the producer
+ * for space or for the ring to drain) sleeps on a condition variable
+ * after announcing it in consumer_waiting or producer_wait_fill. The
+ * other side takes the mutex to wake it only if it is announced, so
+ * the mutex stays out of the path while both sides are busy.
+ */
 static struct vcd_work_item_s work_queue[WORK_QUEUE_SIZE];
-static volatile unsigned work_queue_next = 0;
-static volatile unsigned work_queue_fill = 0;
+static volatile unsigned work_queue_head = 0;
+static volatile unsigned work_queue_tail = 0;
 
 static pthread_mutex_t work_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  work_queue_is_empty_sig = PTHREAD_COND_INITIALIZER;
 static pthread_cond_t  work_queue_notempty_sig = PTHREAD_COND_INITIALIZER;
-static pthread_cond_t  work_queue_minfree_sig = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  work_queue_drained_sig = PTHREAD_COND_INITIALIZER;
 
+static volatile int consumer_waiting = 0;
+  // The fill the producer is waiting for, or -1 if it is not waiting.
+static volatile int producer_wait_fill = -1;
 
-struct vcd_work_item_s* vcd_work_thread_peek(void)
+
+static struct vcd_work_item_s* ring_peek(void)
 {
 	// There must always only be 1 vcd work thread, and only the
-	// work thread decreases the fill, so if the work_queue_fill
-	// is non-zero, I can reliably assume that there is at least
-	// one item that I can peek at. I only need to lock if I must
-	// wait for the work_queue_fill to become non-zero.
-      if (work_queue_fill == 0) {
+	// work thread moves the head, so if the ring is not empty I
+	// can reliably assume that there is at least one item that I
+	// can peek at. I only need to lock if I must sleep until the
+	// producer publishes more.
+      unsigned use_head = work_queue_head;
+      if (work_queue_tail == use_head) {
 	    pthread_mutex_lock(&work_queue_mutex);
-	    while (work_queue_fill == 0)
+	    consumer_waiting = 1;
+	    __sync_synchronize();
+	    while (work_queue_tail == use_head)
 		  pthread_cond_wait(&work_queue_notempty_sig, &work_queue_mutex);
+	    consumer_waiting = 0;
 	    pthread_mutex_unlock(&work_queue_mutex);
       }
 
-      return work_queue + work_queue_next;
+	// Do not read the item ahead of the tail that published it.
+      __sync_synchronize();
+      return work_queue + use_head % WORK_QUEUE_SIZE;
 }
 
-void vcd_work_thread_pop(void)
+static void ring_pop(void)
 {
-      pthread_mutex_lock(&work_queue_mutex);
+      unsigned use_head = work_queue_head;
 
-      unsigned use_fill = work_queue_fill - 1;
-      work_queue_fill = use_fill;
+      struct vcd_work_item_s*cell = work_queue + use_head % WORK_QUEUE_SIZE;
+      if ((cell->type == WT_EMIT_BITS || cell->type == WT_EMIT_TEXT)
+	  && cell->op_.val_char != cell->val_buf) {
+	    free(cell->op_.val_char);
+      }
 
-      unsigned use_next = work_queue_next;
+	// Finish with the item before handing the slot back.
+      __sync_synchronize();
+      use_head += 1;
+      work_queue_head = use_head;
+      __sync_synchronize();
 
-      struct vcd_work_item_s*cell = work_queue + use_next;
-      if (cell->type == WT_EMIT_BITS) {
-	    free(cell->op_.val_char);
+      int wait_fill = producer_wait_fill;
+      if (wait_fill >= 0 && (int)(work_queue_tail - use_head) <= wait_fill) {
+	    pthread_mutex_lock(&work_queue_mutex);
+	    pthread_cond_signal(&work_queue_drained_sig);
+	    pthread_mutex_unlock(&work_queue_mutex);
+      }
+}
+
+/*
+ * Windowed dumping
+ *
+ * In window mode the work thread does not pass the value changes on
+ * to the dumper. It captures them into a list of segments, and keeps
+ * only the segments needed to cover the last window_width ticks. The
+ * dumper starts each segment with a checkpoint (the value of every
+ * dumped item) so that the oldest segment can stand on its own once
+ * the older ones are dropped. When the trigger comes through, the
+ * work thread replays the checkpoint of the oldest segment and the
+ * body of every segment to the dumper, and then goes back to passing
+ * items straight through.
+ *
+ * The captured items are serialized into a byte buffer per checkpoint
+ * and per body, and a buffer is compressed when its segment is
+ * closed, so the window costs a fraction of the memory of the work
+ * items themselves.
+ */
+struct window_blob_s {
+      window_blob_s() : raw_len(0), packed(false) { }
+      std::vector<unsigned char> data;
+      unsigned long raw_len;
+      bool packed;
+};
+
+struct window_segment_s {
+      uint64_t start;
+      window_blob_s checkpoint;
+      window_blob_s body;
+};
+
+  // Written by the producer before the first window item is published.
+static uint64_t window_width = 0;
+
+  // These are only touched by the work thread.
+static std::deque<window_segment_s*> window_segments;
+static window_blob_s*window_target = 0;
+static bool window_replaying = false;
+static size_t replay_seg_idx = 0;
+static bool replay_in_checkpoint = false;
+static std::vector<unsigned char> replay_buf;
+static size_t replay_pos = 0;
+static bool replay_item_ready = false;
+static bool replay_have_time = false;
+static uint64_t replay_last_time = 0;
+static struct vcd_work_item_s replay_item;
+
+static void window_put(window_blob_s*blob, const struct vcd_work_item_s*cell)
+{
+      size_t len = 1 + sizeof cell->time + sizeof cell->sym_;
+      size_t slen = 0;
+      if (cell->type == WT_EMIT_DOUBLE)
+	    len += sizeof cell->op_.val_double;
+      else if (cell->type == WT_EMIT_BITS || cell->type == WT_EMIT_TEXT)
+	    len += slen = strlen(cell->op_.val_char) + 1;
+
+      size_t base = blob->data.size();
+      blob->data.resize(base + len);
+      unsigned char*ptr = &blob->data[base];
+
+      *ptr++ = (unsigned char)cell->type;
+      memcpy(ptr, &cell->time, sizeof cell->time);
+      ptr += sizeof cell->time;
+      memcpy(ptr, &cell->sym_, sizeof cell->sym_);
+      ptr += sizeof cell->sym_;
+      if (cell->type == WT_EMIT_DOUBLE)
+	    memcpy(ptr, &cell->op_.val_double, sizeof cell->op_.val_double);
+      else if (slen > 0)
+	    memcpy(ptr, cell->op_.val_char, slen);
+
+      blob->raw_len = blob->data.size();
+}
+
+/*
+ * Decode the next item of the replay buffer into the cell. The
+ * strings point into the replay buffer, so the item is only good
+ * until the next buffer is loaded.
+ */
+static bool window_get(struct vcd_work_item_s*cell)
+{
+      if (replay_pos >= replay_buf.size())
+	    return false;
+
+      unsigned char*ptr = &replay_buf[replay_pos];
+      cell->type = (vcd_work_item_type_t)*ptr++;
+      memcpy(&cell->time, ptr, sizeof cell->time);
+      ptr += sizeof cell->time;
+      memcpy(&cell->sym_, ptr, sizeof cell->sym_);
+      ptr += sizeof cell->sym_;
+      if (cell->type == WT_EMIT_DOUBLE) {
+	    memcpy(&cell->op_.val_double, ptr, sizeof cell->op_.val_double);
+	    ptr += sizeof cell->op_.val_double;
+      } else if (cell->type == WT_EMIT_BITS || cell->type == WT_EMIT_TEXT) {
+	    cell->op_.val_char = (char*)ptr;
+	    ptr += strlen(cell->op_.val_char) + 1;
+      }
+
+      replay_pos = ptr - &replay_buf[0];
+      return true;
+}
+
+static void window_pack(window_blob_s*blob)
+{
+#ifdef HAVE_LIBZ
+      if (blob->packed || blob->raw_len == 0)
+	    return;
+
+      uLongf len = compressBound(blob->raw_len);
+      std::vector<unsigned char> tmp (len);
+      if (compress2(&tmp[0], &len, &blob->data[0], blob->raw_len, 1) != Z_OK)
+	    return;
+
+      tmp.resize(len);
+      blob->data.swap(tmp);
+      blob->packed = true;
+#endif
+}
+
+static void window_unpack(window_blob_s*blob, std::vector<unsigned char>&out)
+{
+#ifdef HAVE_LIBZ
+      if (blob->packed) {
+	    out.resize(blob->raw_len);
+	    uLongf len = blob->raw_len;
+	    int rc = uncompress(&out[0], &len, &blob->data[0], blob->data.size());
+	    assert(rc == Z_OK && len == blob->raw_len);
+	    return;
       }
+#endif
+      out = blob->data;
+}
 
-      use_next += 1;
-      if (use_next >= WORK_QUEUE_SIZE)
-	    use_next = 0;
-      work_queue_next = use_next;
+static void window_clear(void)
+{
+      for (size_t idx = 0 ; idx < window_segments.size() ; idx += 1)
+	    delete window_segments[idx];
+      window_segments.clear();
+      window_target = 0;
+      window_replaying = false;
+      replay_buf.clear();
+}
 
-      if (use_fill == WORK_QUEUE_SIZE-WORK_QUEUE_BATCH_MIN)
-	    pthread_cond_signal(&work_queue_minfree_sig);
-      else if (use_fill == 0)
-	    pthread_cond_signal(&work_queue_is_empty_sig);
+/*
+ * Close the current segment and start a new one at the given
+ * time. Then drop the oldest segments while the next one still
+ * starts early enough to cover the window on its own.
+ */
+static void window_new_segment(uint64_t start)
+{
+      if (! window_segments.empty()) {
+	    window_segment_s*cur = window_segments.back();
+	    window_pack(&cur->checkpoint);
+	    window_pack(&cur->body);
+      }
 
+      window_segment_s*seg = new window_segment_s;
+      seg->start = start;
+      window_segments.push_back(seg);
+      window_target = &seg->checkpoint;
+
+      while (window_segments.size() >= 2
+	     && window_segments[1]->start + window_width <= start) {
+	    delete window_segments.front();
+	    window_segments.pop_front();
+      }
+}
+
+/*
+ * Load the next buffer to replay: the checkpoint of the first
+ * segment, then the bodies of all the segments.
+ */
+static bool window_load_next(void)
+{
+      while (replay_seg_idx < window_segments.size()) {
+	    window_segment_s*seg = window_segments[replay_seg_idx];
+	    window_blob_s*blob;
+	    if (replay_in_checkpoint) {
+		  blob = &seg->checkpoint;
+		  replay_in_checkpoint = false;
+	    } else {
+		  blob = &seg->body;
+		  replay_seg_idx += 1;
+	    }
+
+	    if (blob->raw_len == 0)
+		  continue;
+
+	    window_unpack(blob, replay_buf);
+	    replay_pos = 0;
+	    return true;
+      }
+
+      return false;
+}
+
+static bool window_replay_next(void)
+{
+      for (;;) {
+	    while (window_get(&replay_item)) {
+		    // A body starts with the time of its segment, which
+		    // the checkpoint before it already set.
+		  if (replay_item.type == WT_EMIT_TIME) {
+			if (replay_have_time && replay_item.time == replay_last_time)
+			      continue;
+			replay_have_time = true;
+			replay_last_time = replay_item.time;
+		  }
+		  return true;
+	    }
+
+	    if (! window_load_next())
+		  return false;
+      }
+}
+
+struct vcd_work_item_s* vcd_work_thread_peek(void)
+{
+      for (;;) {
+	    if (window_replaying) {
+		  if (replay_item_ready || window_replay_next()) {
+			replay_item_ready = true;
+			return &replay_item;
+		  }
+		  window_clear();
+		  continue;
+	    }
+
+	    struct vcd_work_item_s*cell = ring_peek();
+
+	    if (cell->type == WT_WINDOW_CHECKPOINT) {
+		  window_new_segment(cell->time);
+		  ring_pop();
+		  continue;
+	    }
+
+	      // Not capturing, so pass everything through.
+	    if (window_target == 0)
+		  return cell;
+
+	    switch (cell->type) {
+		case WT_NONE:
+		case WT_FLUSH:
+		case WT_TERMINATE:
+		  return cell;
+		case WT_WINDOW_BODY:
+		  window_target = &window_segments.back()->body;
+		  break;
+		case WT_WINDOW_TRIGGER:
+		  window_target = 0;
+		  window_replaying = true;
+		  replay_seg_idx = 0;
+		  replay_in_checkpoint = true;
+		  replay_have_time = false;
+		  replay_buf.clear();
+		  replay_pos = 0;
+		  break;
+		default:
+		  window_put(window_target, cell);
+		  break;
+	    }
+	    ring_pop();
+      }
+}
+
+void vcd_work_thread_pop(void)
+{
+      if (replay_item_ready) {
+	    replay_item_ready = false;
+	    return;
+      }
+
+      ring_pop();
+}
+
+/*
+ * Block the producer until the consumer has brought the published
+ * fill down to no more than the given fill.
+ */
+static void wait_for_fill(unsigned fill)
+{
+      if (work_queue_tail - work_queue_head <= fill)
+	    return;
+
+      pthread_mutex_lock(&work_queue_mutex);
+      producer_wait_fill = fill;
+      __sync_synchronize();
+      while (work_queue_tail - work_queue_head > fill)
+	    pthread_cond_wait(&work_queue_drained_sig, &work_queue_mutex);
+      producer_wait_fill = -1;
       pthread_mutex_unlock(&work_queue_mutex);
 }
 
 /*
  * Work queue items are created in batches to reduce thread
  * bouncing. When the producer gets a free work item, it actually
- * locks the queue in order to produce a batch. The queue stays locked
- * until the batch is complete. Then the releases the whole lot to the
- * consumer.
+ * claims room for a batch past the tail, and fills it in without the
+ * consumer seeing any of it. When the batch is complete the producer
+ * moves the tail to release the whole lot to the consumer.
  */
 static uint64_t work_queue_next_time = 0;
 static unsigned current_batch_cnt = 0;
@@ -157,57 +478,48 @@ static unsigned current_batch_base = 0;
 
 extern "C" void vcd_work_start( void* (*fun) (void*), void*arg )
 {
+      assert(! work_thread_running);
       pthread_create(&work_thread, 0, fun, arg);
+      work_thread_running = true;
 }
 
 static struct vcd_work_item_s* grab_item(void)
 {
       if (current_batch_alloc == 0) {
-	     pthread_mutex_lock(&work_queue_mutex);
-	     while ((WORK_QUEUE_SIZE-work_queue_fill) < WORK_QUEUE_BATCH_MIN)
-		  pthread_cond_wait(&work_queue_minfree_sig, &work_queue_mutex);
-
-	     current_batch_base = work_queue_next + work_queue_fill;
-	     current_batch_alloc = WORK_QUEUE_SIZE - work_queue_fill;
-
-	     pthread_mutex_unlock(&work_queue_mutex);
+	    wait_for_fill(WORK_QUEUE_SIZE-WORK_QUEUE_BATCH_MIN);
 
-	     if (current_batch_base >= WORK_QUEUE_SIZE)
-		   current_batch_base -= WORK_QUEUE_SIZE;
-	     if (current_batch_alloc > WORK_QUEUE_BATCH_MAX)
-		   current_batch_alloc = WORK_QUEUE_BATCH_MAX;
-	     current_batch_cnt = 0;
+	    current_batch_base = work_queue_tail;
+	    current_batch_alloc = WORK_QUEUE_SIZE - (current_batch_base-work_queue_head);
+	    if (current_batch_alloc > WORK_QUEUE_BATCH_MAX)
+		  current_batch_alloc = WORK_QUEUE_BATCH_MAX;
+	    current_batch_cnt = 0;
       }
 
       assert(current_batch_cnt < current_batch_alloc);
 
       unsigned cur = current_batch_base + current_batch_cnt;
-      if (cur >= WORK_QUEUE_SIZE)
-	    cur -= WORK_QUEUE_SIZE;
 
 	// Write the new timestamp into the work item.
-      struct vcd_work_item_s*cell = work_queue + cur;
+      struct vcd_work_item_s*cell = work_queue + cur % WORK_QUEUE_SIZE;
       cell->time = work_queue_next_time;
       return cell;
 }
 
 static void end_batch(void)
 {
-      pthread_mutex_lock(&work_queue_mutex);
-
-      unsigned use_fill = work_queue_fill;
-      bool was_empty_flag = (use_fill==0) && (current_batch_cnt > 0);
-
-      use_fill += current_batch_cnt;
-      work_queue_fill = use_fill;
+	// Fill in the items before publishing them.
+      __sync_synchronize();
+      work_queue_tail = current_batch_base + current_batch_cnt;
+      __sync_synchronize();
 
       current_batch_alloc = 0;
       current_batch_cnt = 0;
 
-      if (was_empty_flag)
+      if (consumer_waiting) {
+	    pthread_mutex_lock(&work_queue_mutex);
 	    pthread_cond_signal(&work_queue_notempty_sig);
-
-      pthread_mutex_unlock(&work_queue_mutex);
+	    pthread_mutex_unlock(&work_queue_mutex);
+      }
 }
 
 static inline void unlock_item(bool flush_batch =false)
@@ -217,17 +529,26 @@ static inline void unlock_item(bool flush_batch =false)
 	    end_batch();
 }
 
+/*
+ * Copy the string into the work item, in place if it fits.
+ */
+static void set_item_string(struct vcd_work_item_s*cell, const char*val)
+{
+      size_t len = strlen(val);
+      if (len < sizeof cell->val_buf) {
+	    memcpy(cell->val_buf, val, len+1);
+	    cell->op_.val_char = cell->val_buf;
+      } else {
+	    cell->op_.val_char = strdup(val);
+      }
+}
+
 void vcd_work_sync(void)
 {
       if (current_batch_alloc > 0)
 	    end_batch();
 
-      if (work_queue_fill > 0) {
-	    pthread_mutex_lock(&work_queue_mutex);
-	    while (work_queue_fill > 0)
-		  pthread_cond_wait(&work_queue_is_empty_sig, &work_queue_mutex);
-	    pthread_mutex_unlock(&work_queue_mutex);
-      }
+      wait_for_fill(0);
 }
 
 void vcd_work_flush(void)
@@ -256,6 +577,22 @@ void vcd_work_set_time(uint64_t val)
       work_queue_next_time = val;
 }
 
+void vcd_work_emit_time(uint64_t val)
+{
+      work_queue_next_time = val;
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_TIME;
+      unlock_item();
+}
+
+void vcd_work_emit_text(const char*text)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_TEXT;
+      set_item_string(cell, text);
+      unlock_item();
+}
+
 void vcd_work_emit_double(struct lxt2_wr_symbol*sym, double val)
 {
       struct vcd_work_item_s*cell = grab_item();
@@ -271,15 +608,113 @@ void vcd_work_emit_bits(struct lxt2_wr_symbol*sym, const char* val)
       struct vcd_work_item_s*cell = grab_item();
       cell->type = WT_EMIT_BITS;
       cell->sym_.lxt2 = sym;
-      cell->op_.val_char = strdup(val);
+      set_item_string(cell, val);
+
+      unlock_item();
+}
+
+void vcd_work_emit_vcd_double(const char*ident, double val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_DOUBLE;
+      cell->sym_.vcd = ident;
+      cell->op_.val_double = val;
+      unlock_item();
+}
+
+void vcd_work_emit_vcd_bits(const char*ident, const char*val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_BITS;
+      cell->sym_.vcd = ident;
+      set_item_string(cell, val);
+      unlock_item();
+}
+
+void vcd_work_emit_fst_double(uint32_t handle, double val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_DOUBLE;
+      cell->sym_.fst = handle;
+      cell->op_.val_double = val;
+      unlock_item();
+}
 
+void vcd_work_emit_fst_bits(uint32_t handle, const char*val)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_EMIT_BITS;
+      cell->sym_.fst = handle;
+      set_item_string(cell, val);
       unlock_item();
 }
 
+/*
+ * The producer side of windowed dumping. The window is cut into
+ * segments of an eighth of its width, so that it holds between one
+ * and one and an eighth windows of history.
+ */
+static bool window_active = false;
+static uint64_t window_span = 0;
+static uint64_t window_seg_time = 0;
+
+void vcd_work_window(uint64_t width)
+{
+      window_active = true;
+      window_width = width;
+      window_span = width/8 ? width/8 : 1;
+}
+
+int vcd_work_window_active(void)
+{
+      return window_active;
+}
+
+int vcd_work_window_due(uint64_t now)
+{
+      return window_active && now - window_seg_time >= window_span;
+}
+
+void vcd_work_window_checkpoint(uint64_t now)
+{
+      assert(window_active);
+      window_seg_time = now;
+      work_queue_next_time = now;
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_WINDOW_CHECKPOINT;
+      unlock_item();
+}
+
+void vcd_work_window_body(void)
+{
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_WINDOW_BODY;
+      unlock_item();
+}
+
+int vcd_work_window_trigger(void)
+{
+      if (! window_active)
+	    return 0;
+
+      window_active = false;
+      struct vcd_work_item_s*cell = grab_item();
+      cell->type = WT_WINDOW_TRIGGER;
+      unlock_item();
+	// Get the window to the disk without waiting for the batch.
+      vcd_work_flush();
+      return 1;
+}
+
 void vcd_work_terminate(void)
 {
+      if (! work_thread_running)
+	    return;
+
       struct vcd_work_item_s*cell = grab_item();
       cell->type = WT_TERMINATE;
       unlock_item(true);
       pthread_join(work_thread, 0);
+      work_thread_running = false;
+      window_clear();
 }
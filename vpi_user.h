@@ -596,6 +596,23 @@ extern void vpip_set_return_value(int value);
 extern s_vpi_vecval vpip_calc_clog2(vpiHandle arg);
 extern void vpip_make_systf_system_defined(vpiHandle ref);
 
+  /* Get the value of a vpiNet or vpiReg object as the words of its
+     run time vector, without formatting it. Bit 0 is the LSB of
+     abits[0]/bbits[0], and there are 8*sizeof(unsigned long) bits
+     per word. The a/b bits for each value are 0=00, 1=10, z=01 and
+     x=11. The words are only valid until the next call. This returns
+     0 (and the caller should use vpi_get_value) if the object has no
+     value that can be fetched this way. This is for waveform dumpers,
+     which would otherwise spend their time making and reading back
+     vpiBinStrVal strings. */
+typedef struct t_vpip_planes {
+      PLI_INT32 size;
+      const unsigned long*abits;
+      const unsigned long*bbits;
+} s_vpip_planes, *p_vpip_planes;
+
+extern PLI_INT32 vpip_get_planes(vpiHandle obj, p_vpip_planes planes);
+
 EXTERN_C_END
 
 #endif
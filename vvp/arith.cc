@@ -52,6 +52,50 @@ void vvp_arith_::dispatch_operand_(vvp_net_ptr_t ptr, vvp_vector4_t bit)
 }
 
 
+/*
+ * Get word wdx of an operand as it is used to make a wid bit result:
+ * The operand bits past the end of the operand are taken from pad,
+ * and the bits past wid are ignored. Return false if any of the
+ * used operand bits is X or Z.
+ */
+static inline bool operand_word_(const vvp_vector4_t&op, unsigned wdx,
+				 unsigned wid, unsigned long pad,
+				 unsigned long&val)
+{
+      const unsigned WORD_BITS = 8 * sizeof(unsigned long);
+      unsigned base = wdx * WORD_BITS;
+
+      unsigned long mask = 0;
+      unsigned long abits = 0, bbits = 0;
+      if (op.size() > base) {
+	    mask = ~0UL;
+	    if (op.size() - base < WORD_BITS)
+		  mask = (1UL << (op.size() - base)) - 1UL;
+	    abits = op.abits_words()[wdx];
+	    bbits = op.bbits_words()[wdx];
+      }
+
+      unsigned long used = ~0UL;
+      if (wid - base < WORD_BITS)
+	    used = (1UL << (wid - base)) - 1UL;
+
+      if (bbits & mask & used)
+	    return false;
+
+      val = (abits & mask) | (pad & ~mask);
+      return true;
+}
+
+/*
+ * Make a vector that has the native word val as its value.
+ */
+static inline vvp_vector4_t word_to_vector4_(unsigned long val, unsigned wid)
+{
+      vvp_vector4_t res (wid, BIT4_0);
+      res.abits_words()[0] = val;
+      return res;
+}
+
 vvp_arith_abs::vvp_arith_abs()
 {
 }
@@ -415,6 +459,32 @@ void vvp_arith_mult::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 }
 
 
+vvp_arith_mult_narrow::vvp_arith_mult_narrow(unsigned wid)
+: vvp_arith_mult(wid)
+{
+      assert(wid <= 8 * sizeof(unsigned long));
+}
+
+void vvp_arith_mult_narrow::recv_vec4(vvp_net_ptr_t ptr,
+				      const vvp_vector4_t&bit,
+				      vvp_context_t)
+{
+      dispatch_operand_(ptr, bit);
+
+	/* Only the low word of each operand matters, no matter how
+	   wide the operands are. */
+      const unsigned WORD_BITS = 8 * sizeof(unsigned long);
+      unsigned long a, b;
+      if (! operand_word_(op_a_, 0, WORD_BITS, 0, a)
+	  || ! operand_word_(op_b_, 0, WORD_BITS, 0, b)) {
+	    ptr.ptr()->send_vec4(x_val_, 0);
+	    return;
+      }
+
+      ptr.ptr()->send_vec4(word_to_vector4_(a * b, wid_), 0);
+}
+
+
 // Power
 
 vvp_arith_pow::vvp_arith_pow(unsigned wid, bool signed_flag)
@@ -471,6 +541,10 @@ vvp_arith_sum::~vvp_arith_sum()
 {
 }
 
+/*
+ * Add a word at a time, carrying between words. The operands are
+ * padded with 0 to the output width.
+ */
 void vvp_arith_sum::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
                               vvp_context_t)
 {
@@ -478,29 +552,50 @@ void vvp_arith_sum::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 
       vvp_net_t*net = ptr.ptr();
 
-      vvp_vector4_t value (wid_);
-
-	/* Pad input vectors with this value to widen to the desired
-	   output width. */
-      const vvp_bit4_t pad = BIT4_0;
-
-      vvp_bit4_t carry = BIT4_0;
-      for (unsigned idx = 0 ;  idx < wid_ ;  idx += 1) {
-	    vvp_bit4_t a = (idx >= op_a_.size())? pad : op_a_.value(idx);
-	    vvp_bit4_t b = (idx >= op_b_.size())? pad : op_b_.value(idx);
-	    vvp_bit4_t cur = add_with_carry(a, b, carry);
+      vvp_vector4_t value (wid_, BIT4_0);
+      unsigned long*res = value.abits_words();
 
-	    if (cur == BIT4_X) {
+      unsigned long carry = 0;
+      for (unsigned wdx = 0 ;  wdx < value.word_count() ;  wdx += 1) {
+	    unsigned long a, b;
+	    if (! operand_word_(op_a_, wdx, wid_, 0, a)
+		|| ! operand_word_(op_b_, wdx, wid_, 0, b)) {
 		  net->send_vec4(x_val_, 0);
 		  return;
 	    }
 
-	    value.set_bit(idx, cur);
+	    unsigned long sum = a + carry;
+	    carry = sum < carry;
+	    sum += b;
+	    carry += sum < b;
+	    res[wdx] = sum;
       }
 
       net->send_vec4(value, 0);
 }
 
+vvp_arith_sum_narrow::vvp_arith_sum_narrow(unsigned wid)
+: vvp_arith_sum(wid)
+{
+      assert(wid <= 8 * sizeof(unsigned long));
+}
+
+void vvp_arith_sum_narrow::recv_vec4(vvp_net_ptr_t ptr,
+				     const vvp_vector4_t&bit,
+				     vvp_context_t)
+{
+      dispatch_operand_(ptr, bit);
+
+      unsigned long a, b;
+      if (! operand_word_(op_a_, 0, wid_, 0, a)
+	  || ! operand_word_(op_b_, 0, wid_, 0, b)) {
+	    ptr.ptr()->send_vec4(x_val_, 0);
+	    return;
+      }
+
+      ptr.ptr()->send_vec4(word_to_vector4_(a + b, wid_), 0);
+}
+
 vvp_arith_sub::vvp_arith_sub(unsigned wid)
 : vvp_arith_(wid)
 {
@@ -514,7 +609,8 @@ vvp_arith_sub::~vvp_arith_sub()
  * Subtraction works by adding the 2s complement of the B input from
  * the A input. The 2s complement is the 1s complement plus one, so we
  * further reduce the operation to adding in the inverted value and
- * adding a correction.
+ * adding a correction. The A operand is padded with 1 and the B
+ * operand with 0 to the output width.
  */
 void vvp_arith_sub::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
                               vvp_context_t)
@@ -523,29 +619,51 @@ void vvp_arith_sub::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
 
       vvp_net_t*net = ptr.ptr();
 
-      vvp_vector4_t value (wid_);
+      vvp_vector4_t value (wid_, BIT4_0);
+      unsigned long*res = value.abits_words();
 
-	/* Pad input vectors with this value to widen to the desired
-	   output width. */
-      const vvp_bit4_t pad = BIT4_1;
-
-      vvp_bit4_t carry = BIT4_1;
-      for (unsigned idx = 0 ;  idx < wid_ ;  idx += 1) {
-	    vvp_bit4_t a = (idx >= op_a_.size())? pad : op_a_.value(idx);
-	    vvp_bit4_t b = (idx >= op_b_.size())? pad : ~op_b_.value(idx);
-	    vvp_bit4_t cur = add_with_carry(a, b, carry);
-
-	    if (cur == BIT4_X) {
+      unsigned long carry = 1;
+      for (unsigned wdx = 0 ;  wdx < value.word_count() ;  wdx += 1) {
+	    unsigned long a, b;
+	    if (! operand_word_(op_a_, wdx, wid_, ~0UL, a)
+		|| ! operand_word_(op_b_, wdx, wid_, 0, b)) {
 		  net->send_vec4(x_val_, 0);
 		  return;
 	    }
 
-	    value.set_bit(idx, cur);
+	    b = ~b;
+	    unsigned long sum = a + carry;
+	    carry = sum < carry;
+	    sum += b;
+	    carry += sum < b;
+	    res[wdx] = sum;
       }
 
       net->send_vec4(value, 0);
 }
 
+vvp_arith_sub_narrow::vvp_arith_sub_narrow(unsigned wid)
+: vvp_arith_sub(wid)
+{
+      assert(wid <= 8 * sizeof(unsigned long));
+}
+
+void vvp_arith_sub_narrow::recv_vec4(vvp_net_ptr_t ptr,
+				     const vvp_vector4_t&bit,
+				     vvp_context_t)
+{
+      dispatch_operand_(ptr, bit);
+
+      unsigned long a, b;
+      if (! operand_word_(op_a_, 0, wid_, ~0UL, a)
+	  || ! operand_word_(op_b_, 0, wid_, 0, b)) {
+	    ptr.ptr()->send_vec4(x_val_, 0);
+	    return;
+      }
+
+      ptr.ptr()->send_vec4(word_to_vector4_(a - b, wid_), 0);
+}
+
 vvp_cmp_eeq::vvp_cmp_eeq(unsigned wid)
 : vvp_arith_(wid)
 {
@@ -557,15 +675,8 @@ void vvp_cmp_eeq::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       dispatch_operand_(ptr, bit);
 
       vvp_vector4_t eeq (1);
-      eeq.set_bit(0, BIT4_1);
-
       assert(op_a_.size() == op_b_.size());
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1)
-	    if (op_a_.value(idx) != op_b_.value(idx)) {
-		  eeq.set_bit(0, BIT4_0);
-		  break;
-	    }
-
+      eeq.set_bit(0, op_a_.eeq(op_b_)? BIT4_1 : BIT4_0);
 
       vvp_net_t*net = ptr.ptr();
       net->send_vec4(eeq, 0);
@@ -582,20 +693,41 @@ void vvp_cmp_nee::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       dispatch_operand_(ptr, bit);
 
       vvp_vector4_t eeq (1);
-      eeq.set_bit(0, BIT4_0);
-
       assert(op_a_.size() == op_b_.size());
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1)
-	    if (op_a_.value(idx) != op_b_.value(idx)) {
-		  eeq.set_bit(0, BIT4_1);
-		  break;
-	    }
-
+      eeq.set_bit(0, op_a_.eeq(op_b_)? BIT4_0 : BIT4_1);
 
       vvp_net_t*net = ptr.ptr();
       net->send_vec4(eeq, 0);
 }
 
+/*
+ * Compare two vectors of the same size a word at a time. Return
+ * BIT4_0 if in any bit position the bits are known and different,
+ * otherwise BIT4_X if there are X/Z bits anywhere, otherwise BIT4_1.
+ */
+static vvp_bit4_t compare_eq_(const vvp_vector4_t&a, const vvp_vector4_t&b)
+{
+      const unsigned WORD_BITS = 8 * sizeof(unsigned long);
+      const unsigned long*aa = a.abits_words();
+      const unsigned long*ab = a.bbits_words();
+      const unsigned long*ba = b.abits_words();
+      const unsigned long*bb = b.bbits_words();
+
+      unsigned long xz = 0;
+      for (unsigned wdx = 0 ;  wdx < a.word_count() ;  wdx += 1) {
+	    unsigned long mask = ~0UL;
+	    if (a.size() - wdx*WORD_BITS < WORD_BITS)
+		  mask = (1UL << (a.size() - wdx*WORD_BITS)) - 1UL;
+
+	    unsigned long tmp = (ab[wdx] | bb[wdx]) & mask;
+	    if ((aa[wdx] ^ ba[wdx]) & ~tmp & mask)
+		  return BIT4_0;
+	    xz |= tmp;
+      }
+
+      return xz? BIT4_X : BIT4_1;
+}
+
 vvp_cmp_eq::vvp_cmp_eq(unsigned wid)
 : vvp_arith_(wid)
 {
@@ -619,25 +751,7 @@ void vvp_cmp_eq::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 
       vvp_vector4_t res (1);
-      res.set_bit(0, BIT4_1);
-
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1) {
-	    vvp_bit4_t a = op_a_.value(idx);
-	    vvp_bit4_t b = op_b_.value(idx);
-
-	    if (a == BIT4_X)
-		  res.set_bit(0, BIT4_X);
-	    else if (a == BIT4_Z)
-		  res.set_bit(0, BIT4_X);
-	    else if (b == BIT4_X)
-		  res.set_bit(0, BIT4_X);
-	    else if (b == BIT4_Z)
-		  res.set_bit(0, BIT4_X);
-            else if (a != b) {
-		  res.set_bit(0, BIT4_0);
-		  break;
-	    }
-      }
+      res.set_bit(0, compare_eq_(op_a_, op_b_));
 
       vvp_net_t*net = ptr.ptr();
       net->send_vec4(res, 0);
@@ -667,25 +781,7 @@ void vvp_cmp_ne::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 
       vvp_vector4_t res (1);
-      res.set_bit(0, BIT4_0);
-
-      for (unsigned idx = 0 ;  idx < op_a_.size() ;  idx += 1) {
-	    vvp_bit4_t a = op_a_.value(idx);
-	    vvp_bit4_t b = op_b_.value(idx);
-
-	    if (a == BIT4_X)
-		  res.set_bit(0, BIT4_X);
-	    else if (a == BIT4_Z)
-		  res.set_bit(0, BIT4_X);
-	    else if (b == BIT4_X)
-		  res.set_bit(0, BIT4_X);
-	    else if (b == BIT4_Z)
-		  res.set_bit(0, BIT4_X);
-            else if (a != b) {
-		  res.set_bit(0, BIT4_1);
-		  break;
-	    }
-      }
+      res.set_bit(0, ~compare_eq_(op_a_, op_b_));
 
       vvp_net_t*net = ptr.ptr();
       net->send_vec4(res, 0);
@@ -715,6 +811,54 @@ void vvp_cmp_gtge_base_::recv_vec4_base_(vvp_net_ptr_t ptr,
 }
 
 
+/*
+ * This is recv_vec4_base_ for operands of at most one word, which is
+ * compared as native integers. Wider operands still get through
+ * (their width need not match the width of the node) and are passed
+ * on to recv_vec4_base_.
+ */
+void vvp_cmp_gtge_base_::recv_vec4_narrow_(vvp_net_ptr_t ptr,
+					   const vvp_vector4_t&bit,
+					   vvp_bit4_t out_if_equal)
+{
+      const unsigned WORD_BITS = 8 * sizeof(unsigned long);
+      unsigned asize = ptr.port() == 0? bit.size() : op_a_.size();
+      unsigned bsize = ptr.port() == 1? bit.size() : op_b_.size();
+      if (asize > WORD_BITS || bsize > WORD_BITS
+	  || asize == 0 || bsize == 0 || (signed_flag_ && asize != bsize)) {
+	    recv_vec4_base_(ptr, bit, out_if_equal);
+	    return;
+      }
+
+      dispatch_operand_(ptr, bit);
+
+      vvp_bit4_t out;
+      unsigned long a, b;
+      if (! operand_word_(op_a_, 0, WORD_BITS, 0, a)
+	  || ! operand_word_(op_b_, 0, WORD_BITS, 0, b)) {
+	    out = BIT4_X;
+
+      } else {
+	    if (signed_flag_ && asize < WORD_BITS) {
+		  unsigned long sign = 1UL << (asize-1);
+		  a = (a ^ sign) - sign;
+		  b = (b ^ sign) - sign;
+	    }
+
+	    bool gt, eq = (a == b);
+	    if (signed_flag_)
+		  gt = (long)a > (long)b;
+	    else
+		  gt = a > b;
+
+	    out = eq? out_if_equal : (gt? BIT4_1 : BIT4_0);
+      }
+
+      vvp_vector4_t val (1);
+      val.set_bit(0, out);
+      ptr.ptr()->send_vec4(val, 0);
+}
+
 vvp_cmp_ge::vvp_cmp_ge(unsigned wid, bool flag)
 : vvp_cmp_gtge_base_(wid, flag)
 {
@@ -737,6 +881,28 @@ void vvp_cmp_gt::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       recv_vec4_base_(ptr, bit, BIT4_0);
 }
 
+vvp_cmp_ge_narrow::vvp_cmp_ge_narrow(unsigned wid, bool flag)
+: vvp_cmp_gtge_base_(wid, flag)
+{
+}
+
+void vvp_cmp_ge_narrow::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                                  vvp_context_t)
+{
+      recv_vec4_narrow_(ptr, bit, BIT4_1);
+}
+
+vvp_cmp_gt_narrow::vvp_cmp_gt_narrow(unsigned wid, bool flag)
+: vvp_cmp_gtge_base_(wid, flag)
+{
+}
+
+void vvp_cmp_gt_narrow::recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                                  vvp_context_t)
+{
+      recv_vec4_narrow_(ptr, bit, BIT4_0);
+}
+
 
 vvp_shiftl::vvp_shiftl(unsigned wid)
 : vvp_arith_(wid)
@@ -36,6 +36,7 @@ class vvp_arith_  : public vvp_net_fun_t {
 
     public:
       explicit vvp_arith_(unsigned wid);
+      bool local_only(void) const { return true; }
 
     protected:
       void dispatch_operand_(vvp_net_ptr_t ptr, vvp_vector4_t bit);
@@ -166,6 +167,8 @@ class vvp_cmp_gtge_base_ : public vvp_arith_ {
     protected:
       void recv_vec4_base_(vvp_net_ptr_t ptr, vvp_vector4_t bit,
 			   vvp_bit4_t out_if_equal);
+      void recv_vec4_narrow_(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+			     vvp_bit4_t out_if_equal);
     private:
       bool signed_flag_;
 };
@@ -189,6 +192,30 @@ class vvp_cmp_gt  : public vvp_cmp_gtge_base_ {
                      vvp_context_t);
 };
 
+/*
+ * The *_narrow functors are the versions of the arithmetic functors
+ * that compile.cc uses when the node is at most one word (an
+ * unsigned long) wide. They work on the operands as native integers,
+ * with a single X/Z check of each operand.
+ */
+class vvp_cmp_ge_narrow  : public vvp_cmp_gtge_base_ {
+
+    public:
+      explicit vvp_cmp_ge_narrow(unsigned wid, bool signed_flag);
+
+      void recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                     vvp_context_t);
+};
+
+class vvp_cmp_gt_narrow  : public vvp_cmp_gtge_base_ {
+
+    public:
+      explicit vvp_cmp_gt_narrow(unsigned wid, bool signed_flag);
+
+      void recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                     vvp_context_t);
+};
+
 /*
  * NOTE: The inputs to the vvp_arith_mult are not necessarily the same
  * width as the output. This is different from the typical vvp_arith_
@@ -205,6 +232,14 @@ class vvp_arith_mult  : public vvp_arith_ {
       void wide_(vvp_net_ptr_t ptr);
 };
 
+class vvp_arith_mult_narrow  : public vvp_arith_mult {
+
+    public:
+      explicit vvp_arith_mult_narrow(unsigned wid);
+      void recv_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
+                     vvp_context_t);
+};
+
 class vvp_arith_pow  : public vvp_arith_ {
 
     public:
@@ -226,6 +261,14 @@ class vvp_arith_sub  : public vvp_arith_ {
 
 };
 
+class vvp_arith_sub_narrow  : public vvp_arith_sub {
+
+    public:
+      explicit vvp_arith_sub_narrow(unsigned wid);
+      virtual void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+                             vvp_context_t);
+};
+
 class vvp_arith_sum  : public vvp_arith_ {
 
     public:
@@ -236,6 +279,14 @@ class vvp_arith_sum  : public vvp_arith_ {
 
 };
 
+class vvp_arith_sum_narrow  : public vvp_arith_sum {
+
+    public:
+      explicit vvp_arith_sum_narrow(unsigned wid);
+      virtual void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
+                             vvp_context_t);
+};
+
 class vvp_shiftl  : public vvp_arith_ {
 
     public:
@@ -96,6 +96,65 @@ vvp_code_t codespace_null(void)
       return first_chunk + 0;
 }
 
+static bool is_branch_opcode(vvp_code_fun opcode)
+{
+      return opcode == &of_JMP
+	  || opcode == &of_JMP0
+	  || opcode == &of_JMP0XZ
+	  || opcode == &of_JMP1;
+}
+
+/*
+ * Follow a chain of unconditional jumps to its end. Give up if the
+ * chain is suspiciously long, as it may be a loop of jumps, and in
+ * that case leave the branch alone.
+ */
+static vvp_code_t final_branch_target(vvp_code_t target)
+{
+      vvp_code_t cur = target;
+      for (unsigned idx = 0 ;  idx < 64 ;  idx += 1) {
+	    if (cur == 0 || cur->opcode != &of_JMP)
+		  return cur;
+	    cur = cur->cptr;
+      }
+
+      return target;
+}
+
+void codespace_scan(void (*fun)(vvp_code_t cp))
+{
+      vvp_code_t chunk = first_chunk;
+      while (chunk) {
+	    unsigned cnt = code_chunk_size-1;
+	    if (chunk == current_chunk)
+		  cnt = current_within_chunk;
+
+	    for (unsigned idx = 0 ;  idx < cnt ;  idx += 1)
+		  fun(chunk + idx);
+
+	    if (chunk == current_chunk)
+		  break;
+	    chunk = chunk[code_chunk_size-1].cptr;
+      }
+}
+
+static void predecode_branch(vvp_code_t cp)
+{
+      if (! is_branch_opcode(cp->opcode))
+	    return;
+
+      vvp_code_t target = final_branch_target(cp->cptr);
+      if (target != cp->cptr) {
+	    cp->cptr = target;
+	    count_opcodes_threaded += 1;
+      }
+}
+
+void codespace_predecode(void)
+{
+      codespace_scan(&predecode_branch);
+}
+
 #ifdef CHECK_WITH_VALGRIND
 void codespace_delete(void)
 {
@@ -167,6 +167,21 @@ extern bool of_XORR(vthread_t thr, vvp_code_t code);
 
 extern bool of_ZOMBIE(vthread_t thr, vvp_code_t code);
 
+/*
+ * These are superinstructions substituted by the compile_fuse pass
+ * for a compare that is immediately followed by a conditional branch
+ * (%jmp/0, %jmp/0xz or %jmp/1). The compare operands stay where they
+ * were, and the branch instruction is left in place after the fused
+ * instruction, where it supplies the branch operands. That keeps the
+ * code correct if anything else jumps directly to the branch.
+ */
+extern bool of_CMPIS_JMP(vthread_t thr, vvp_code_t code);
+extern bool of_CMPIU_JMP(vthread_t thr, vvp_code_t code);
+extern bool of_CMPS_JMP(vthread_t thr, vvp_code_t code);
+extern bool of_CMPU_JMP(vthread_t thr, vvp_code_t code);
+extern bool of_CMPX_JMP(vthread_t thr, vvp_code_t code);
+extern bool of_CMPZ_JMP(vthread_t thr, vvp_code_t code);
+
 extern bool of_EXEC_UFUNC(vthread_t thr, vvp_code_t code);
 
 extern bool of_CHUNK_LINK(vthread_t thr, vvp_code_t code);
@@ -212,4 +227,28 @@ extern vvp_code_t codespace_allocate(void);
 extern vvp_code_t codespace_next(void);
 extern vvp_code_t codespace_null(void);
 
+/*
+ * Call the fun for every instruction allocated so far, in address
+ * order. The chunk link instructions are skipped.
+ */
+extern void codespace_scan(void (*fun)(vvp_code_t cp));
+
+/*
+ * Once all the code labels are resolved, this makes a pass over the
+ * code space to shorten the paths the threads take through it. Any
+ * branch that lands on an unconditional %jmp is pointed directly at
+ * the final destination, so the thread does not dispatch through the
+ * chain of jumps at run time.
+ */
+extern void codespace_predecode(void);
+
+/*
+ * Return the mnemonic for an opcode function, for reports. Opcodes
+ * that specialize themselves at run time (vthread_generic_opcode
+ * undoes that) and superinstructions are named after what they
+ * replaced.
+ */
+extern const char* codespace_opcode_name(vvp_code_fun opcode);
+extern vvp_code_fun vthread_generic_opcode(vvp_code_fun opcode);
+
 #endif
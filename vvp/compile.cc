@@ -606,6 +606,77 @@ void compile_compiletf(struct __vpiSysTaskCall*obj)
  * the final stuff. Clean up deferred linking here.
  */
 
+/*
+ * This is the peephole pass that looks for instruction sequences that
+ * can be replaced with a superinstruction. It is run on each
+ * instruction after all the code labels are resolved.
+ */
+bool compile_fuse_flag = true;
+
+static const struct fuse_table_s {
+      vvp_code_fun opcode;
+      vvp_code_fun fused;
+      const char*mnemonic;
+} fuse_cmp_jmp_table[] = {
+      { of_CMPIS, of_CMPIS_JMP, "%cmpi/s+jmp" },
+      { of_CMPIU, of_CMPIU_JMP, "%cmpi/u+jmp" },
+      { of_CMPS,  of_CMPS_JMP,  "%cmp/s+jmp" },
+      { of_CMPU,  of_CMPU_JMP,  "%cmp/u+jmp" },
+      { of_CMPX,  of_CMPX_JMP,  "%cmp/x+jmp" },
+      { of_CMPZ,  of_CMPZ_JMP,  "%cmp/z+jmp" },
+      { 0, 0, 0 }
+};
+
+static void compile_fuse(vvp_code_t cp)
+{
+	/* Compare followed by a conditional branch. The instruction
+	   after cp is in the same chunk, or else it would be the
+	   chunk link. */
+      vvp_code_t jp = cp + 1;
+      if (jp->opcode != of_JMP0 && jp->opcode != of_JMP0XZ
+	  && jp->opcode != of_JMP1)
+	    return;
+
+      for (const struct fuse_table_s*cur = fuse_cmp_jmp_table
+		 ; cur->opcode ;  cur += 1) {
+	    if (cp->opcode != cur->opcode)
+		  continue;
+	    cp->opcode = cur->fused;
+	    count_opcodes_fused += 1;
+	    return;
+      }
+}
+
+const char* codespace_opcode_name(vvp_code_fun opcode)
+{
+      opcode = vthread_generic_opcode(opcode);
+
+      for (unsigned idx = 0 ; idx < opcode_count ; idx += 1) {
+	    if (opcode_table[idx].opcode == opcode)
+		  return opcode_table[idx].mnemonic;
+      }
+
+      for (const struct fuse_table_s*cur = fuse_cmp_jmp_table
+		 ; cur->opcode ;  cur += 1) {
+	    if (cur->fused == opcode)
+		  return cur->mnemonic;
+      }
+
+	/* These are generated by their own compile functions. */
+      if (opcode == &of_VPI_CALL)
+	    return "%vpi_call";
+      if (opcode == &of_FORK)
+	    return "%fork";
+      if (opcode == &of_DISABLE)
+	    return "%disable";
+      if (opcode == &of_EXEC_UFUNC)
+	    return "%exec_ufunc";
+      if (opcode == &of_CHUNK_LINK)
+	    return "(chunk link)";
+
+      return "%?";
+}
+
 void compile_cleanup(void)
 {
       int lnerrs = -1;
@@ -666,6 +737,10 @@ void compile_cleanup(void)
       compile_island_cleanup();
       compile_array_cleanup();
 
+      if (compile_fuse_flag)
+	    codespace_scan(&compile_fuse);
+      codespace_predecode();
+
       if (verbose_flag) {
 	    fprintf(stderr, " ... Compiletf functions\n");
 	    fflush(stderr);
@@ -706,6 +781,20 @@ void compile_init(void)
       codespace_init();
 }
 
+/*
+ * Guess from the size of the input file how many labels the symbol
+ * tables will need to hold, so that they are allocated once instead
+ * of being grown (and rehashed) over and over while a large design is
+ * loaded. The divisors are rough bytes-per-label figures for typical
+ * compiled designs. A bad guess only costs some memory or a rehash.
+ */
+void compile_reserve_symbols(unsigned long file_size)
+{
+      sym_functors->sym_reserve(file_size / 128);
+      sym_vpi->sym_reserve(file_size / 256);
+      sym_codespace->sym_reserve(file_size / 512);
+}
+
 void compile_load_vpi_module(char*name)
 {
       vpip_load_module(name);
@@ -870,11 +959,27 @@ void wide_inputs_connect(vvp_wide_fun_core*core,
       }
 }
 
+/*
+ * The vec4 arithmetic functors compute and send a whole new result
+ * for every input change, and the result is very often unchanged
+ * (compares especially), so give their nets an output cache. The
+ * real functors are left alone.
+ */
+static void cache_arith_output_(vvp_net_t*ptr, vvp_arith_*)
+{
+      ptr->cache_output();
+}
+
+static void cache_arith_output_(vvp_net_t*, vvp_arith_real_*)
+{
+}
+
 template <class T_> void make_arith(T_ *arith, char*label,
 				    unsigned argc, struct symb_s*argv)
 {
       vvp_net_t* ptr = new vvp_net_t;
       ptr->fun = arith;
+      cache_arith_output_(ptr, arith);
 
       define_functor_symbol(label, ptr);
       free(label);
@@ -1001,7 +1106,11 @@ void compile_arith_mult(char*label, long wid,
 	    return;
       }
 
-      vvp_arith_ *arith = new vvp_arith_mult(wid);
+      vvp_arith_ *arith;
+      if (wid <= 8 * (long)sizeof(unsigned long))
+	    arith = new vvp_arith_mult_narrow(wid);
+      else
+	    arith = new vvp_arith_mult(wid);
       make_arith(arith, label, argc, argv);
 }
 
@@ -1058,7 +1167,11 @@ void compile_arith_sub(char*label, long wid, unsigned argc, struct symb_s*argv)
 	    return;
       }
 
-      vvp_arith_ *arith = new vvp_arith_sub(wid);
+      vvp_arith_ *arith;
+      if (wid <= 8 * (long)sizeof(unsigned long))
+	    arith = new vvp_arith_sub_narrow(wid);
+      else
+	    arith = new vvp_arith_sub(wid);
       make_arith(arith, label, argc, argv);
 }
 
@@ -1084,7 +1197,11 @@ void compile_arith_sum(char*label, long wid, unsigned argc, struct symb_s*argv)
 	    return;
       }
 
-      vvp_arith_ *arith = new vvp_arith_sum(wid);
+      vvp_arith_ *arith;
+      if (wid <= 8 * (long)sizeof(unsigned long))
+	    arith = new vvp_arith_sum_narrow(wid);
+      else
+	    arith = new vvp_arith_sum(wid);
       make_arith(arith, label, argc, argv);
 }
 
@@ -1195,7 +1312,11 @@ void compile_cmp_ge(char*label, long wid, bool signed_flag,
 	    return;
       }
 
-      vvp_arith_ *arith = new vvp_cmp_ge(wid, signed_flag);
+      vvp_arith_ *arith;
+      if (wid <= 8 * (long)sizeof(unsigned long))
+	    arith = new vvp_cmp_ge_narrow(wid, signed_flag);
+      else
+	    arith = new vvp_cmp_ge(wid, signed_flag);
 
       make_arith(arith, label, argc, argv);
 }
@@ -1223,7 +1344,11 @@ void compile_cmp_gt(char*label, long wid, bool signed_flag,
 	    return;
       }
 
-      vvp_arith_ *arith = new vvp_cmp_gt(wid, signed_flag);
+      vvp_arith_ *arith;
+      if (wid <= 8 * (long)sizeof(unsigned long))
+	    arith = new vvp_cmp_gt_narrow(wid, signed_flag);
+      else
+	    arith = new vvp_cmp_gt(wid, signed_flag);
 
       make_arith(arith, label, argc, argv);
 }
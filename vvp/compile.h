@@ -47,8 +47,21 @@ extern void compile_init(void);
 
 extern void compile_cleanup(void);
 
+/*
+ * The parser calls this with the size of the input file before it
+ * starts parsing, to pre-size the symbol tables.
+ */
+extern void compile_reserve_symbols(unsigned long file_size);
+
 extern bool verbose_flag;
 
+/*
+ * If true (the default) compile_cleanup fuses common instruction
+ * sequences into superinstructions. Clear this (vvp -F) to run the
+ * code exactly as written, for debugging.
+ */
+extern bool compile_fuse_flag;
+
 /*
  * If this file opened, then write debug information to this
  * file. This is used for debugging the VVP runtime itself.
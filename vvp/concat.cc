@@ -102,6 +102,7 @@ void compile_concat(char*label, unsigned w0, unsigned w1,
 
       vvp_net_t*net = new vvp_net_t;
       net->fun = fun;
+      net->cache_output();
 
       define_functor_symbol(label, net);
       free(label);
@@ -143,6 +144,7 @@ void compile_repeat(char*label, long width, long repeat, struct symb_s arg)
 
       vvp_net_t*net = new vvp_net_t;
       net->fun = fun;
+      net->cache_output();
 
       define_functor_symbol(label, net);
       free(label);
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+# include  "version_base.h"
+# include  "config.h"
+# include  "image.h"
+# include  "parse_misc.h"
+# include  "compile.h"
+# include  "parse.h"
+# include  <cstdlib>
+# include  <cstring>
+# include  <cassert>
+# include  <inttypes.h>
+#ifdef HAVE_SYS_MMAN_H
+# include  <sys/mman.h>
+#endif
+
+/*
+ * The image starts with this header. Then come the tokens, each the
+ * token code plus one, followed by its value if it has one:
+ *
+ *    T_LABEL, T_SYMBOL, T_INSTR, T_STRING
+ *        length, then the text without the trailing nul
+ *    T_VECTOR
+ *        width, length, then the text
+ *    T_NUMBER
+ *        the number
+ *
+ * A code of 0 is not a token. It is followed by how many lines the
+ * source moves down before the next token. The last token is the end
+ * of input (token 0, code 1).
+ *
+ * Codes, lengths and numbers are written 7 bits to a byte, low bits
+ * first, with the top bit set in every byte but the last. Most of
+ * them then take one byte, and the image is about the size of the
+ * text it came from.
+ */
+static const char image_magic[16] = "vvp token image";
+static const uint32_t image_byte_order = 0x01020304;
+
+struct image_header_s {
+      char magic[16];
+      uint32_t byte_order;
+	// The code of the last token that the parser declares, which
+	// changes if the tokens change.
+      uint32_t last_token;
+      uint32_t reserved;
+	// The size of the whole image, written when it is complete.
+      uint64_t image_size;
+      uint64_t source_size;
+      char version[32];
+};
+
+bool image_saving = false;
+bool image_loading = false;
+
+static FILE*save_fd = 0;
+static const char*save_path = 0;
+static unsigned save_line = 0;
+
+static const char*load_base = 0;
+static size_t load_size = 0;
+static const char*load_ptr = 0;
+static const char*load_end = 0;
+static bool load_mapped = false;
+
+static void fill_header(struct image_header_s&hdr)
+{
+      memset(&hdr, 0, sizeof hdr);
+      memcpy(hdr.magic, image_magic, sizeof hdr.magic);
+      hdr.byte_order = image_byte_order;
+      hdr.last_token = T_VECTOR;
+      strncpy(hdr.version, VERSION, sizeof hdr.version - 1);
+}
+
+bool image_save_open(const char*path, unsigned long source_size)
+{
+      save_fd = fopen(path, "w+b");
+      if (save_fd == 0) {
+	    fprintf(stderr, "%s: Unable to open image file for writing.\n",
+		    path);
+	    return false;
+      }
+
+      save_path = path;
+      save_line = 1;
+
+	/* Write the header now to hold its place, and again when the
+	   image is complete. */
+      struct image_header_s hdr;
+      fill_header(hdr);
+      hdr.source_size = source_size;
+      fwrite(&hdr, sizeof hdr, 1, save_fd);
+
+      image_saving = true;
+      return true;
+}
+
+static void save_number(uint64_t val)
+{
+      while (val >= 0x80) {
+	    putc((val & 0x7f) | 0x80, save_fd);
+	    val >>= 7;
+      }
+      putc(val, save_fd);
+}
+
+static void save_text(const char*text)
+{
+      size_t len = strlen(text);
+      save_number(len);
+      fwrite(text, 1, len, save_fd);
+}
+
+/*
+ * This is called with each token before the parser gets it, so
+ * yylval still holds the value of the token.
+ */
+void image_save_token(int tok)
+{
+      if (yyline != save_line) {
+	    save_number(0);
+	    save_number(yyline - save_line);
+	    save_line = yyline;
+      }
+
+      save_number(tok + 1);
+      switch (tok) {
+	  case T_LABEL:
+	  case T_SYMBOL:
+	  case T_INSTR:
+	  case T_STRING:
+	    save_text(yylval.text);
+	    break;
+	  case T_VECTOR:
+	    save_number(yylval.vect.idx);
+	    save_text(yylval.vect.text);
+	    break;
+	  case T_NUMBER:
+	    save_number(yylval.numb);
+	    break;
+	  default:
+	    break;
+      }
+}
+
+void image_save_close(bool parse_ok)
+{
+      image_saving = false;
+      if (save_fd == 0)
+	    return;
+
+      if (parse_ok) {
+	    struct image_header_s hdr;
+	    uint64_t image_size = ftell(save_fd);
+	    rewind(save_fd);
+	    if (fread(&hdr, sizeof hdr, 1, save_fd) == 1) {
+		  hdr.image_size = image_size;
+		  rewind(save_fd);
+		  fwrite(&hdr, sizeof hdr, 1, save_fd);
+	    }
+      }
+
+      bool ok = parse_ok && !ferror(save_fd);
+      if (fclose(save_fd) != 0)
+	    ok = false;
+      save_fd = 0;
+
+      if (parse_ok && !ok)
+	    fprintf(stderr, "%s: Unable to write image file.\n", save_path);
+      if (!ok)
+	    remove(save_path);
+}
+
+int image_load_open(FILE*fd, const char*path, unsigned long&source_size)
+{
+      struct image_header_s hdr;
+      if (fread(&hdr, sizeof hdr, 1, fd) != 1
+	  || memcmp(hdr.magic, image_magic, sizeof hdr.magic) != 0) {
+	    rewind(fd);
+	    return 0;
+      }
+
+      struct image_header_s want;
+      fill_header(want);
+      if (hdr.byte_order != want.byte_order
+	  || hdr.last_token != want.last_token
+	  || strncmp(hdr.version, want.version, sizeof hdr.version) != 0) {
+	    fprintf(stderr, "%s: This image was written by a different "
+		    "vvp. Save it again from the .vvp file.\n", path);
+	    return -1;
+      }
+      if (fseek(fd, 0, SEEK_END) != 0) {
+	    fprintf(stderr, "%s: Unable to get the image size.\n", path);
+	    return -1;
+      }
+      load_size = ftell(fd);
+      if (hdr.image_size == 0 || hdr.image_size != load_size) {
+	    fprintf(stderr, "%s: This image is incomplete.\n", path);
+	    return -1;
+      }
+
+#ifdef HAVE_SYS_MMAN_H
+      void*map = mmap(0, load_size, PROT_READ, MAP_PRIVATE, fileno(fd), 0);
+      if (map != MAP_FAILED) {
+	    load_base = (const char*)map;
+	    load_mapped = true;
+# ifdef MADV_SEQUENTIAL
+	    madvise(map, load_size, MADV_SEQUENTIAL);
+# endif
+      }
+#endif
+	/* Without mmap, read the whole image into memory. */
+      if (load_base == 0) {
+	    char*buf = (char*)malloc(load_size);
+	    rewind(fd);
+	    if (buf == 0 || fread(buf, 1, load_size, fd) != load_size) {
+		  fprintf(stderr, "%s: Unable to read the image.\n", path);
+		  free(buf);
+		  return -1;
+	    }
+	    load_base = buf;
+	    load_mapped = false;
+      }
+
+      load_ptr = load_base + sizeof hdr;
+      load_end = load_base + load_size;
+      source_size = hdr.source_size;
+      image_loading = true;
+      return 1;
+}
+
+static uint64_t load_number(void)
+{
+      uint64_t val = 0;
+      unsigned shift = 0;
+      while (load_ptr < load_end) {
+	    unsigned char byte = *load_ptr++;
+	    if (shift < 64)
+		  val |= (uint64_t)(byte & 0x7f) << shift;
+	    if ((byte & 0x80) == 0)
+		  break;
+	    shift += 7;
+      }
+      return val;
+}
+
+/*
+ * Copy text out of the image into a buffer of at least min_size
+ * bytes. The lexor makes T_STRING text with new[] and the rest with
+ * malloc, and the parser frees it to match.
+ */
+static char* load_text(bool new_flag, size_t min_size)
+{
+      size_t len = load_number();
+      if (len > (size_t)(load_end - load_ptr))
+	    len = load_end - load_ptr;
+
+      size_t size = len + 1;
+      if (size < min_size)
+	    size = min_size;
+      char*text = new_flag? new char[size] : (char*)malloc(size);
+      assert(text);
+      memcpy(text, load_ptr, len);
+      text[len] = 0;
+      load_ptr += len;
+      return text;
+}
+
+int image_load_token(void)
+{
+      uint64_t code;
+      while ((code = load_number()) == 0) {
+	    if (load_ptr >= load_end)
+		  return 0;
+	    yyline += load_number();
+      }
+
+      int tok = code - 1;
+      switch (tok) {
+	  case T_LABEL:
+	  case T_SYMBOL:
+	  case T_INSTR:
+	    yylval.text = load_text(false, 0);
+	    break;
+	  case T_STRING:
+	    yylval.text = load_text(true, 0);
+	    break;
+	  case T_VECTOR:
+	    yylval.vect.idx = load_number();
+	      /* The lexor leaves room for the sign flag. */
+	    yylval.vect.text = load_text(false, yylval.vect.idx + 2);
+	    break;
+	  case T_NUMBER:
+	    yylval.numb = load_number();
+	    break;
+	  default:
+	    break;
+      }
+
+      return tok;
+}
+
+void image_load_close(void)
+{
+      image_loading = false;
+#ifdef HAVE_SYS_MMAN_H
+      if (load_mapped)
+	    munmap((void*)load_base, load_size);
+#endif
+      if (! load_mapped)
+	    free((void*)load_base);
+
+      load_base = 0;
+      load_ptr = 0;
+      load_end = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef __image_H
+#define __image_H
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+# include  <cstdio>
+
+/*
+ * A token image is a .vvp file that has already been through the
+ * lexor. It holds the token codes and token values in binary form.
+ * The -i flag saves one while the text is loaded. When vvp is later
+ * given the image in place of the .vvp file, it maps the image into
+ * memory and hands the saved tokens to the parser, so the text is
+ * not scanned again.
+ *
+ * The image is only good for the vvp that wrote it, since the token
+ * codes come from the parser. The header records the version, and
+ * any other vvp refuses the image.
+ */
+
+extern bool image_saving;
+extern bool image_loading;
+
+/*
+ * Start saving the tokens of the input file to the path. The
+ * source_size is the size of the .vvp text. Close the image after the
+ * input file is parsed. If the parse failed, the partial image is
+ * removed.
+ */
+extern bool image_save_open(const char*path, unsigned long source_size);
+extern void image_save_token(int tok);
+extern void image_save_close(bool parse_ok);
+
+/*
+ * Check whether the open input file is a token image. If it is not,
+ * return 0 and leave the file alone. If it is, map it, return 1 and
+ * set source_size to the size of the .vvp text it was made from. If
+ * it is an image this vvp cannot use, print why and return -1.
+ */
+extern int image_load_open(FILE*fd, const char*path,
+			   unsigned long&source_size);
+extern int image_load_token(void);
+extern void image_load_close(void);
+
+#endif
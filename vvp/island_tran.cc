@@ -22,13 +22,43 @@
 # include  "symbols.h"
 # include  "schedule.h"
 # include  <list>
+# include  <map>
 
 using namespace std;
 
+struct vvp_island_branch_tran;
+
+/*
+ * The branches of a tran island fall into connected components,
+ * the sets of branches that are joined together through nodes
+ * whether the branches are enabled or not. Nothing in one component
+ * can affect the resolution of another, except through the enables
+ * of tranif branches, so when a port changes only the components
+ * that the port feeds need to be solved again.
+ *
+ * The components are found the first time the island runs, and
+ * each port gets the list of the components that its value feeds
+ * as a branch end or as an enable.
+ */
 class vvp_island_tran : public vvp_island {
 
     public:
+      vvp_island_tran();
       void run_island();
+
+    private:
+      void find_components_();
+
+      struct component_s {
+	    vector<vvp_island_branch_tran*> branches;
+	      // Branches (of any component) that are enabled by a
+	      // .port that is a branch end in this component.
+	    vector<vvp_island_branch_tran*> enables;
+	    bool pending;
+      };
+
+      vector<component_s> components_;
+      bool components_ready_;
 };
 
 struct vvp_island_branch_tran : public vvp_island_branch {
@@ -37,11 +67,15 @@ struct vvp_island_branch_tran : public vvp_island_branch {
 	// class. The members here are specific to the tran island
 	// class.)
       bool run_test_enabled();
+      bool test_enable() const;
       void run_resolution();
       bool active_high;
       bool enabled_flag;
       vvp_net_t*en;
       unsigned width, part, offset;
+	// The connected component of the island that this branch is
+	// in. (See vvp_island_tran.)
+      unsigned component;
 
       void clear_resolution_flags() { flags_ &= ~0x0f; }
 
@@ -66,31 +100,158 @@ static inline vvp_island_branch_tran* BRANCH_TRAN(vvp_island_branch*tmp)
       return res;
 }
 
+vvp_island_tran::vvp_island_tran()
+: components_ready_(false)
+{
+}
+
+static vvp_island_port* island_port(vvp_net_t*net)
+{
+      return net? dynamic_cast<vvp_island_port*>(net->fun) : 0;
+}
+
+static void add_component(vector<unsigned>&list, unsigned comp)
+{
+      if (list.empty() || list.back() != comp)
+	    list.push_back(comp);
+}
+
+void vvp_island_tran::find_components_()
+{
+      const unsigned NONE = ~0U;
+
+      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch)
+	    BRANCH_TRAN(cur)->component = NONE;
+
+	// Span the mesh from each branch that is not yet in a
+	// component, following the nodes at both ends.
+      unsigned count = 0;
+      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
+	    if (BRANCH_TRAN(cur)->component != NONE)
+		  continue;
+
+	    list<vvp_island_branch_tran*> work;
+	    BRANCH_TRAN(cur)->component = count;
+	    work.push_back(BRANCH_TRAN(cur));
+	    while (! work.empty()) {
+		  vvp_island_branch_tran*br = work.front();
+		  work.pop_front();
+		  for (unsigned ab = 0 ;  ab < 2 ;  ab += 1) {
+			list<vvp_branch_ptr_t> connections;
+			island_collect_node(connections, vvp_branch_ptr_t(br, ab));
+			for (list<vvp_branch_ptr_t>::iterator idx = connections.begin()
+				   ; idx != connections.end() ; idx ++ ) {
+			      vvp_island_branch_tran*tmp = BRANCH_TRAN(idx->ptr());
+			      if (tmp->component != NONE)
+				    continue;
+			      tmp->component = count;
+			      work.push_back(tmp);
+			}
+		  }
+	    }
+	    count += 1;
+      }
+
+	// Give each component its branches, in the order of the
+	// island branch list so that each component is solved in
+	// the same order as before.
+      components_.resize(count);
+      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
+	    vvp_island_branch_tran*tmp = BRANCH_TRAN(cur);
+	    components_[tmp->component].branches.push_back(tmp);
+      }
+
+	// Now tell the ports what components they feed. Also note
+	// which component writes the outvalue of the ports that are
+	// branch ends, so that enables that read that outvalue can
+	// be tracked.
+      map<vvp_net_t*,unsigned> end_component;
+      for (unsigned comp = 0 ;  comp < count ;  comp += 1) {
+	    component_s&cur = components_[comp];
+	    cur.pending = true;
+	    for (unsigned idx = 0 ;  idx < cur.branches.size() ;  idx += 1) {
+		  vvp_island_branch_tran*br = cur.branches[idx];
+		  add_component(island_port(br->a)->components, comp);
+		  add_component(island_port(br->b)->components, comp);
+		  end_component[br->a] = comp;
+		  end_component[br->b] = comp;
+		  if (vvp_island_port*ep = island_port(br->en))
+			add_component(ep->components, comp);
+	    }
+      }
+
+      for (unsigned comp = 0 ;  comp < count ;  comp += 1) {
+	    component_s&cur = components_[comp];
+	    for (unsigned idx = 0 ;  idx < cur.branches.size() ;  idx += 1) {
+		  vvp_net_t*en = cur.branches[idx]->en;
+		  map<vvp_net_t*,unsigned>::const_iterator src = end_component.find(en);
+		  if (en == 0 || src == end_component.end())
+			continue;
+
+		  components_[src->second].enables.push_back(cur.branches[idx]);
+	    }
+      }
+
+      components_ready_ = true;
+}
+
 /*
  * The run_island() method is called by the scheduler to run the
- * entire island. We run the island by calling run_resolution() for
- * all the branches in the island.
+ * island. We run the island by calling run_resolution() for all the
+ * branches in the components that need it: all of them the first
+ * time, then the ones that the flagged ports feed.
 */
 void vvp_island_tran::run_island()
 {
+      if (! components_ready_)
+	    find_components_();
+
+      for (unsigned idx = 0 ;  idx < flagged_ports_.size() ;  idx += 1) {
+	    vvp_island_port*port = flagged_ports_[idx];
+	    port->flagged = false;
+	    for (unsigned cdx = 0 ;  cdx < port->components.size() ;  cdx += 1)
+		  components_[port->components[cdx]].pending = true;
+      }
+      flagged_ports_.clear();
+
+      vector<unsigned> run_list;
+      for (unsigned comp = 0 ;  comp < components_.size() ;  comp += 1) {
+	    if (! components_[comp].pending)
+		  continue;
+	    components_[comp].pending = false;
+	    run_list.push_back(comp);
+      }
+
 	// Test to see if any of the branches are enabled. This loop
 	// tests the enabled inputs for all the branches and caches
 	// the results in the enabled_flag for each branch. The
 	// run_test_enabled() method also clears all the processing
 	// flags for the branches so that we are in a good start
 	// state.
-      bool runnable = false;
-      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    runnable |= tmp->run_test_enabled();
+      for (unsigned idx = 0 ;  idx < run_list.size() ;  idx += 1) {
+	    component_s&cur = components_[run_list[idx]];
+	    for (unsigned bdx = 0 ;  bdx < cur.branches.size() ;  bdx += 1)
+		  cur.branches[bdx]->run_test_enabled();
       }
 
-	// Now resolve all the branches in the island.
-      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    tmp->run_resolution();
+	// Now resolve all the branches in those components.
+      for (unsigned idx = 0 ;  idx < run_list.size() ;  idx += 1) {
+	    component_s&cur = components_[run_list[idx]];
+	    for (unsigned bdx = 0 ;  bdx < cur.branches.size() ;  bdx += 1)
+		  cur.branches[bdx]->run_resolution();
+      }
+
+	// The enables read above were the values from before this
+	// run. If this run changed what a branch enable now reads,
+	// then the component of that branch is solved again the next
+	// time the island runs.
+      for (unsigned idx = 0 ;  idx < run_list.size() ;  idx += 1) {
+	    component_s&cur = components_[run_list[idx]];
+	    for (unsigned edx = 0 ;  edx < cur.enables.size() ;  edx += 1) {
+		  vvp_island_branch_tran*br = cur.enables[edx];
+		  if (br->test_enable() != br->enabled_flag)
+			components_[br->component].pending = true;
+	    }
       }
 }
 
@@ -99,14 +260,18 @@ bool vvp_island_branch_tran::run_test_enabled()
 	// Clear all the flags.
       clear_resolution_flags();
 
+      enabled_flag = test_enable();
+      return enabled_flag;
+}
+
+bool vvp_island_branch_tran::test_enable() const
+{
       vvp_island_port*ep = en? dynamic_cast<vvp_island_port*> (en->fun) : 0;
 
 	// If there is no ep port (no "enabled" input) then this is a
 	// tran branch. Assume it is always enabled.
-      if (ep == 0) {
-	    enabled_flag = true;
+      if (ep == 0)
 	    return true;
-      }
 
 	// Get the input that is driving this enable.
 	// SPECIAL NOTE: Try to get the input value from the
@@ -123,7 +288,6 @@ bool vvp_island_branch_tran::run_test_enabled()
 	//
 	// If the outvalue is nil, then we know that this port is a
 	// .import after all, so just read the invalue.
-      enabled_flag = false;
       vvp_bit4_t enable_val;
       if (ep->outvalue.size() != 0)
 	    enable_val = ep->outvalue.value(0).value();
@@ -138,7 +302,6 @@ bool vvp_island_branch_tran::run_test_enabled()
       if (active_high==false && enable_val != BIT4_0)
 	    return false;
 
-      enabled_flag = true;
       return true;
 }
 
@@ -72,6 +72,29 @@ void vvp_fun_boolean_::recv_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&bit,
       }
 }
 
+/*
+ * The inputs of a boolean functor are nearly always all as wide as
+ * the functor, and then the functor can be evaluated a word at a
+ * time on the raw abits/bbits words. The per-bit loops remain for
+ * odd widths.
+ */
+static bool same_width_(const vvp_vector4_t input[4])
+{
+      unsigned wid = input[0].size();
+      return input[1].size() == wid
+	    && input[2].size() == wid
+	    && input[3].size() == wid;
+}
+
+/*
+ * Invert a word of 4-value bits in place: 0 and 1 swap, and X and Z
+ * both become X.
+ */
+static inline void invert_word_(unsigned long&abits, unsigned long bbits)
+{
+      abits = ~abits | bbits;
+}
+
 vvp_fun_and::vvp_fun_and(unsigned wid, bool invert)
 : vvp_fun_boolean_(wid), invert_(invert)
 {
@@ -89,6 +112,29 @@ void vvp_fun_and::run_run()
 
       vvp_vector4_t result (input_[0]);
 
+      if (same_width_(input_)) {
+	      /* A bit is 0 if any input is 0, 1 if all are 1, else X. */
+	    unsigned long*ra = result.abits_words();
+	    unsigned long*rb = result.bbits_words();
+	    unsigned words = result.word_count();
+	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
+		  const unsigned long*pa = input_[pdx].abits_words();
+		  const unsigned long*pb = input_[pdx].bbits_words();
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1) {
+			unsigned long tmp1 = ra[wdx] | rb[wdx];
+			unsigned long tmp2 = pa[wdx] | pb[wdx];
+			ra[wdx] = tmp1 & tmp2;
+			rb[wdx] = (tmp1 & pb[wdx]) | (tmp2 & rb[wdx]);
+		  }
+	    }
+	    if (invert_) {
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1)
+			invert_word_(ra[wdx], rb[wdx]);
+	    }
+	    ptr->send_vec4(result, 0);
+	    return;
+      }
+
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
 	    vvp_bit4_t bitbit = result.value(idx);
 	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
@@ -408,6 +454,23 @@ void vvp_fun_muxz::run_run()
 	    break;
 	  default:
 	      {
+		    if (a_.size() == b_.size()) {
+			    /* Bits that differ become X. */
+			  vvp_vector4_t res (a_);
+			  unsigned long*ra = res.abits_words();
+			  unsigned long*rb = res.bbits_words();
+			  const unsigned long*pa = b_.abits_words();
+			  const unsigned long*pb = b_.bbits_words();
+			  for (unsigned wdx = 0 ; wdx < res.word_count() ; wdx += 1) {
+				unsigned long diff = (ra[wdx] ^ pa[wdx])
+				                   | (rb[wdx] ^ pb[wdx]);
+				ra[wdx] |= diff;
+				rb[wdx] |= diff;
+			  }
+			  ptr->send_vec4(res, 0);
+			  break;
+		    }
+
 		    unsigned min_size = a_.size();
 		    unsigned max_size = a_.size();
 		    if (b_.size() < min_size)
@@ -510,6 +573,29 @@ void vvp_fun_or::run_run()
 
       vvp_vector4_t result (input_[0]);
 
+      if (same_width_(input_)) {
+	      /* A bit is 1 if any input is 1, 0 if all are 0, else X. */
+	    unsigned long*ra = result.abits_words();
+	    unsigned long*rb = result.bbits_words();
+	    unsigned words = result.word_count();
+	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
+		  const unsigned long*pa = input_[pdx].abits_words();
+		  const unsigned long*pb = input_[pdx].bbits_words();
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1) {
+			unsigned long tmp = ra[wdx] | rb[wdx] | pa[wdx] | pb[wdx];
+			rb[wdx] = ((~ra[wdx] | rb[wdx]) & pb[wdx])
+			        | ((~pa[wdx] | pb[wdx]) & rb[wdx]);
+			ra[wdx] = tmp;
+		  }
+	    }
+	    if (invert_) {
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1)
+			invert_word_(ra[wdx], rb[wdx]);
+	    }
+	    ptr->send_vec4(result, 0);
+	    return;
+      }
+
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
 	    vvp_bit4_t bitbit = result.value(idx);
 	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
@@ -546,6 +632,27 @@ void vvp_fun_xor::run_run()
 
       vvp_vector4_t result (input_[0]);
 
+      if (same_width_(input_)) {
+	      /* A bit is X if any input is X or Z. */
+	    unsigned long*ra = result.abits_words();
+	    unsigned long*rb = result.bbits_words();
+	    unsigned words = result.word_count();
+	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
+		  const unsigned long*pa = input_[pdx].abits_words();
+		  const unsigned long*pb = input_[pdx].bbits_words();
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1) {
+			rb[wdx] |= pb[wdx];
+			ra[wdx] = (ra[wdx] ^ pa[wdx]) | rb[wdx];
+		  }
+	    }
+	    if (invert_) {
+		  for (unsigned wdx = 0 ; wdx < words ; wdx += 1)
+			invert_word_(ra[wdx], rb[wdx]);
+	    }
+	    ptr->send_vec4(result, 0);
+	    return;
+      }
+
       for (unsigned idx = 0 ;  idx < result.size() ;  idx += 1) {
 	    vvp_bit4_t bitbit = result.value(idx);
 	    for (unsigned pdx = 1 ;  pdx < 4 ;  pdx += 1) {
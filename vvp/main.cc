@@ -25,6 +25,7 @@
 # include  "schedule.h"
 # include  "vpi_priv.h"
 # include  "statistics.h"
+# include  "profile.h"
 # include  "vvp_cleanup.h"
 # include  <cstdio>
 # include  <cstdlib>
@@ -89,9 +90,9 @@ static void my_getrusage(struct rusage *a)
 #     endif
 }
 
-static void print_rusage(struct rusage *a, struct rusage *b)
+static double rusage_seconds(struct rusage *a, struct rusage *b)
 {
-      double delta = a->ru_utime.tv_sec
+      return a->ru_utime.tv_sec
 	    +        a->ru_utime.tv_usec/1E6
 	    +        a->ru_stime.tv_sec
 	    +        a->ru_stime.tv_usec/1E6
@@ -100,6 +101,11 @@ static void print_rusage(struct rusage *a, struct rusage *b)
 	    -        b->ru_stime.tv_sec
 	    -        b->ru_stime.tv_usec/1E6
 	    ;
+}
+
+static void print_rusage(struct rusage *a, struct rusage *b)
+{
+      double delta = rusage_seconds(a, b);
 
       vpi_mcd_printf(1,
 	      " ... %G seconds,"
@@ -115,6 +121,7 @@ static void print_rusage(struct rusage *a, struct rusage *b)
 // Provide dummies
 struct rusage { int x; };
 inline static void my_getrusage(struct rusage *) { }
+inline static double rusage_seconds(struct rusage *, struct rusage *) { return 0.0; }
 inline static void print_rusage(struct rusage *, struct rusage *){};
 
 #endif // ! defined(HAVE_SYS_RESOURCE_H)
@@ -204,7 +211,10 @@ int main(int argc, char*argv[])
       unsigned flag_errors = 0;
       const char*design_path = 0;
       struct rusage cycles[3];
+      struct rusage load_cycles[3];
       const char *logfile_name = 0x0;
+      const char *profile_path = 0;
+      const char *image_path = 0;
       FILE *logfile = 0x0;
       extern void vpi_set_vlog_info(int, char**);
       extern bool stop_is_finish;
@@ -242,22 +252,46 @@ int main(int argc, char*argv[])
         /* For non-interactive runs we do not want to run the interactive
          * debugger, so make $stop just execute a $finish. */
       stop_is_finish = false;
-      while ((opt = getopt(argc, argv, "+hl:M:m:nNsvV")) != EOF) switch (opt) {
+      while ((opt = getopt(argc, argv, "+A:CFhi:j:l:M:m:nNP:Q:svV")) != EOF) switch (opt) {
+	  case 'A':
+	    array_sparse_words = strtoul(optarg, 0, 0);
+	    break;
+	  case 'C':
+	    schedule_coalesce = true;
+	    break;
+	  case 'F':
+	    compile_fuse_flag = false;
+	    break;
          case 'h':
            fprintf(stderr,
                    "Usage: vvp [options] input-file [+plusargs...]\n"
                    "Options:\n"
+		   " -A words       Store arrays this big or bigger sparsely (0 = never).\n"
+		   " -C             Coalesce nonblocking assigns to a net in a time step.\n"
+		   " -F             Do not fuse instructions into superinstructions.\n"
                    " -h             Print this help message.\n"
+		   " -i file        Also save a token image of the input file.\n"
+		   " -j threads     Run independent parts of the net on threads.\n"
                    " -l file        Logfile, '-' for <stderr>\n"
                    " -M path        VPI module directory\n"
 		   " -M -           Clear VPI module path\n"
                    " -m module      Load vpi module.\n"
 		   " -n             Non-interactive ($stop = $finish).\n"
                    " -N             Same as -n, but exit code is 1 instead of 0\n"
+		   " -P file        Profile the run, write folded stacks to file.\n"
+		   " -Q list|wheel  Event queue for future time steps (default wheel).\n"
 		   " -s             $stop right away.\n"
                    " -v             Verbose progress messages.\n"
                    " -V             Print the version information.\n" );
            exit(0);
+	  case 'i':
+	    image_path = optarg;
+	    break;
+	  case 'j':
+	    schedule_threads = strtoul(optarg, 0, 0);
+	    if (schedule_threads < 1)
+		  schedule_threads = 1;
+	    break;
 	  case 'l':
 	    logfile_name = optarg;
 	    break;
@@ -279,6 +313,20 @@ int main(int argc, char*argv[])
             stop_is_finish = true;
             stop_is_finish_exit_code = 1;
             break;
+	  case 'P':
+	    profile_path = optarg;
+	    break;
+	  case 'Q':
+	    if (strcmp(optarg,"list") == 0) {
+		  schedule_use_wheel = false;
+	    } else if (strcmp(optarg,"wheel") == 0) {
+		  schedule_use_wheel = true;
+	    } else {
+		  fprintf(stderr, "%s: Unknown event queue \"%s\".\n",
+			  argv[0], optarg);
+		  flag_errors += 1;
+	    }
+	    break;
 	  case 's':
 	    schedule_stop(0);
 	    break;
@@ -365,11 +413,19 @@ int main(int argc, char*argv[])
       for (unsigned idx = 0 ;  idx < module_cnt ;  idx += 1)
 	    vpip_load_module(module_tab[idx]);
 
-      int ret_cd = compile_design(design_path);
+      if (verbose_flag)
+	    my_getrusage(load_cycles+0);
+
+      int ret_cd = compile_design(design_path, image_path);
       destroy_lexor();
       print_vpi_call_errors();
       if (ret_cd) return ret_cd;
 
+      if (verbose_flag) {
+	    my_getrusage(load_cycles+1);
+	    load_time_parse = rusage_seconds(load_cycles+1, load_cycles+0);
+      }
+
       if (!have_ivl_version) {
 	    if (verbose_flag) vpi_mcd_printf(1, "... ");
 	    vpi_mcd_printf(1, "Warning: vvp input file may not be correct "
@@ -382,6 +438,11 @@ int main(int argc, char*argv[])
 
       compile_cleanup();
 
+      if (verbose_flag) {
+	    my_getrusage(load_cycles+2);
+	    load_time_link = rusage_seconds(load_cycles+2, load_cycles+1);
+      }
+
       if (compile_errors > 0) {
 	    vpi_mcd_printf(1, "%s: Program not runnable, %u errors.\n",
 		    design_path, compile_errors);
@@ -405,12 +466,18 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, " ... %8lu filters (net_fil pool=%zu bytes)\n",
 #endif
 			   count_filters, vvp_net_fil_t::heap_total());
+	    vpi_mcd_printf(1, "           %8lu output caches\n",
+			   count_cached_nets);
 #ifdef __MINGW32__  /* MinGW does not know about z. */
 	    vpi_mcd_printf(1, " ... %8lu opcodes (%u bytes)\n",
 #else
 	    vpi_mcd_printf(1, " ... %8lu opcodes (%zu bytes)\n",
 #endif
 	                   count_opcodes, size_opcodes);
+	    vpi_mcd_printf(1, "           %8lu branches threaded\n",
+			   count_opcodes_threaded);
+	    vpi_mcd_printf(1, "           %8lu superinstructions\n",
+			   count_opcodes_fused);
 	    vpi_mcd_printf(1, " ... %8lu nets\n",     count_vpi_nets);
 #ifdef __MINGW32__  /* MinGW does not know about z. */
 	    vpi_mcd_printf(1, " ... %8lu vvp_nets (%u bytes)\n",
@@ -418,6 +485,11 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, " ... %8lu vvp_nets (%zu bytes)\n",
 #endif
 			   count_vvp_nets, size_vvp_nets);
+	    unsigned long partitions, partition_max;
+	    vvp_net_t::count_partitions(partitions, partition_max);
+	    vpi_mcd_printf(1, "           %8lu independent partitions "
+			   "(largest %lu vvp_nets)\n",
+			   partitions, partition_max);
 	    vpi_mcd_printf(1, " ... %8lu arrays (%lu words)\n",
 			   count_net_arrays, count_net_array_words);
 	    vpi_mcd_printf(1, " ... %8lu memories\n",
@@ -427,6 +499,8 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, "           %8lu real (%lu words)\n",
 			   count_real_arrays, count_real_array_words);
 	    vpi_mcd_printf(1, " ... %8lu scopes\n",   count_vpi_scopes);
+	    vpi_mcd_printf(1, " ... %G seconds parsing, %G seconds linking\n",
+			   load_time_parse, load_time_link);
       }
 
       if (verbose_flag) {
@@ -436,8 +510,14 @@ int main(int argc, char*argv[])
       }
 
 
+      if (profile_path)
+	    profile_start(profile_path);
+
       schedule_simulate();
 
+      if (profile_path)
+	    profile_finish();
+
       if (verbose_flag) {
 	    my_getrusage(cycles+2);
 	    print_rusage(cycles+2, cycles+1);
@@ -445,10 +525,24 @@ int main(int argc, char*argv[])
 	    vpi_mcd_printf(1, "Event counts:\n");
 	    vpi_mcd_printf(1, "    %8lu time steps (pool=%lu)\n",
 			   count_time_events, count_time_pool());
+	    if (schedule_use_wheel) {
+		  vpi_mcd_printf(1, "    %8lu time wheel cascades\n",
+				 count_wheel_cascades);
+		  for (unsigned idx = 0 ; idx < schedule_wheel_levels() ; idx += 1) {
+			if (count_wheel_peak[idx] == 0) continue;
+			vpi_mcd_printf(1, "             ...level %u peak "
+				       "occupancy=%lu/%u buckets\n", idx,
+				       count_wheel_peak[idx],
+				       schedule_wheel_slots());
+		  }
+	    }
 	    vpi_mcd_printf(1, "    %8lu thread schedule events\n",
 		    count_thread_events);
 	    vpi_mcd_printf(1, "    %8lu assign events\n",
 		    count_assign_events);
+	    if (schedule_coalesce)
+		  vpi_mcd_printf(1, "             ...%lu saved by coalescing\n",
+				 count_coalesced_events);
 	    vpi_mcd_printf(1, "             ...assign(vec4) pool=%lu\n",
 			   count_assign4_pool());
 	    vpi_mcd_printf(1, "             ...assign(vec8) pool=%lu\n",
@@ -461,6 +555,24 @@ int main(int argc, char*argv[])
 			   count_assign_arword_pool());
 	    vpi_mcd_printf(1, "    %8lu other events (pool=%lu)\n",
 			   count_gen_events, count_gen_pool());
+	    if (schedule_threads > 1)
+		  vpi_mcd_printf(1, "    %8lu partition batches "
+				 "(%lu events)\n", count_partition_runs,
+				 count_partition_events);
+	    vpi_mcd_printf(1, "    %8lu unchanged outputs not propagated\n",
+			   count_propagations_cut);
+	    vpi_mcd_printf(1, "    %8lu vec4 word arrays allocated\n",
+			   count_vector4_allocs);
+	    vpi_mcd_printf(1, "    %8lu vec4 values swapped into events\n",
+			   count_vector4_swaps);
+	    vpi_mcd_printf(1, "    %8lu array pages allocated\n",
+			   count_array_pages);
+	    vpi_mcd_printf(1, "    %8lu threads (%lu reused)\n",
+			   count_vthreads+count_vthreads_reused,
+			   count_vthreads_reused);
+	    vpi_mcd_printf(1, "    %8lu automatic contexts (%lu reused)\n",
+			   count_contexts+count_contexts_reused,
+			   count_contexts_reused);
       }
 
 /*
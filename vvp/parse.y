@@ -22,9 +22,14 @@
 # include  "parse_misc.h"
 # include  "compile.h"
 # include  "delay.h"
+# include  "image.h"
 # include  <cstdio>
 # include  <cstdlib>
+# include  <cstring>
 # include  <cassert>
+#ifdef HAVE_POSIX_FADVISE
+# include  <fcntl.h>
+#endif
 
 /*
  * These are bits in the lexor.
@@ -42,6 +47,23 @@ vector <const char*> file_names;
  * the source items will attach themselves to.
  */
 static struct __vpiModPath*modpath_dst = 0;
+
+/*
+ * The parser gets its tokens through here. They come from the lexor,
+ * or from a token image if the input file is one. If a token image
+ * is being saved, the tokens from the lexor go into that as well.
+ */
+static int (*const lexor_yylex)(void) = yylex;
+
+static int compile_yylex(void)
+{
+      int tok = image_loading? image_load_token() : lexor_yylex();
+      if (image_saving)
+	    image_save_token(tok);
+      return tok;
+}
+
+#define yylex compile_yylex
 %}
 
 %union {
@@ -1003,7 +1025,7 @@ delay
 
 %%
 
-int compile_design(const char*path)
+int compile_design(const char*path, const char*image_path)
 {
       yypath = path;
       yyline = 1;
@@ -1013,7 +1035,51 @@ int compile_design(const char*path)
 	    return -1;
       }
 
+      unsigned long source_size = 0;
+      int image_rc = image_load_open(yyin, path, source_size);
+      if (image_rc < 0) {
+	    fclose(yyin);
+	    return -1;
+      }
+
+      if (image_rc == 0 && fseek(yyin, 0, SEEK_END) == 0) {
+	    long size = ftell(yyin);
+	    if (size > 0)
+		  source_size = size;
+	    rewind(yyin);
+      }
+      if (source_size > 0)
+	    compile_reserve_symbols(source_size);
+
+      if (image_path) {
+	    if (image_rc > 0 && strcmp(image_path, path) == 0) {
+		  fprintf(stderr, "%s: Cannot save an image over itself.\n",
+			  path);
+		  image_load_close();
+		  fclose(yyin);
+		  return -1;
+	    }
+	    if (! image_save_open(image_path, source_size)) {
+		  if (image_rc > 0) image_load_close();
+		  fclose(yyin);
+		  return -1;
+	    }
+      }
+
+#ifdef HAVE_POSIX_FADVISE
+	/* The file is read front to back exactly once. Tell the
+	   kernel so, and have it start pulling the whole thing in
+	   now, so that disk (or network file system) reads overlap
+	   the parse instead of stalling it one buffer at a time. */
+      posix_fadvise(fileno(yyin), 0, 0, POSIX_FADV_SEQUENTIAL);
+      posix_fadvise(fileno(yyin), 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
       int rc = yyparse();
+      if (image_path)
+	    image_save_close(rc == 0);
+      if (image_rc > 0)
+	    image_load_close();
       fclose(yyin);
       return rc;
 }
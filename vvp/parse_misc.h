@@ -23,9 +23,11 @@
 
 /*
  * This method is called to compile the design file. The input is read
- * and a list of statements is created.
+ * and a list of statements is created. The input may be a .vvp file
+ * or a token image of one. If image_path is not nil, a token image of
+ * the input is also saved there.
  */
-extern int compile_design(const char*path);
+extern int compile_design(const char*path, const char*image_path);
 
 /*
  * This routine is called to check that the input file has a compatible
@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+# include  "config.h"
+# include  "profile.h"
+# include  "codes.h"
+# include  "vpi_priv.h"
+# include  "vvp_net.h"
+# include  <typeinfo>
+# include  <string>
+# include  <vector>
+# include  <map>
+# include  <algorithm>
+# include  <cstdio>
+# include  <cstdlib>
+# include  <cstring>
+#ifdef __GNUC__
+# include  <cxxabi.h>
+#endif
+#ifdef HAVE_SETITIMER
+# include  <csignal>
+# include  <sys/time.h>
+#endif
+
+/* Sample period of the profiling timer, in microseconds. The system
+   may round this up to its clock tick. */
+static const long profile_period = 1000;
+
+enum profile_kind_t {
+      PROFILE_OPCODE,
+      PROFILE_FUNCTOR,
+      PROFILE_VPI_CALL,
+      PROFILE_CALLBACK
+};
+
+typedef bool (*profile_opcode_fun)(struct vthread_s*, struct vvp_code_s*);
+
+/*
+ * A bucket is identified by its kind and up to two keys. The scope
+ * (or functor type_info) is the first, and the opcode or name the
+ * second. Names are keyed by address; the systf names and the
+ * callback reason names are permanent strings.
+ */
+struct profile_bucket_s {
+      enum profile_kind_t kind;
+      const void*obj;
+      profile_opcode_fun opcode;
+      const char*name;
+
+      unsigned long calls;
+      volatile unsigned long samples;
+
+      struct profile_bucket_s*next;
+};
+
+bool profile_active = false;
+struct profile_bucket_s*volatile profile_current = 0;
+
+  /* Samples that landed outside of any bucket. This is the time in
+     the scheduler itself. */
+static volatile unsigned long profile_other = 0;
+
+static const char*profile_path = 0;
+
+static struct profile_bucket_s**profile_table = 0;
+static unsigned long profile_mask = 0;
+static unsigned long profile_count = 0;
+
+static inline unsigned long profile_hash(enum profile_kind_t kind,
+					 const void*obj,
+					 profile_opcode_fun opcode,
+					 const char*name)
+{
+      size_t key = (size_t)obj ^ ((size_t)opcode >> 2) ^ ((size_t)name >> 3);
+      key ^= key >> 13;
+      key *= 0x9e3779b1UL;
+      key ^= key >> 16;
+      return (unsigned long)key + (unsigned long)kind;
+}
+
+static void profile_rehash(void)
+{
+      unsigned long new_mask = profile_mask*2 + 1;
+      struct profile_bucket_s**new_table = new struct profile_bucket_s*[new_mask+1];
+      memset(new_table, 0, (new_mask+1) * sizeof(*new_table));
+
+      for (unsigned long idx = 0 ; idx <= profile_mask ; idx += 1) {
+	    while (struct profile_bucket_s*cur = profile_table[idx]) {
+		  profile_table[idx] = cur->next;
+		  unsigned long hash = profile_hash(cur->kind, cur->obj,
+						    cur->opcode, cur->name);
+		  cur->next = new_table[hash & new_mask];
+		  new_table[hash & new_mask] = cur;
+	    }
+      }
+
+      delete[]profile_table;
+      profile_table = new_table;
+      profile_mask = new_mask;
+}
+
+static struct profile_bucket_s* profile_lookup(enum profile_kind_t kind,
+					       const void*obj,
+					       profile_opcode_fun opcode,
+					       const char*name)
+{
+      unsigned long hash = profile_hash(kind, obj, opcode, name);
+      struct profile_bucket_s*cur = profile_table[hash & profile_mask];
+      while (cur) {
+	    if (cur->obj == obj && cur->opcode == opcode
+		&& cur->name == name && cur->kind == kind) {
+		  cur->calls += 1;
+		  return cur;
+	    }
+	    cur = cur->next;
+      }
+
+	/* The bucket is linked into the table completely formed, so
+	   the signal handler never sees it half made. */
+      cur = new struct profile_bucket_s;
+      cur->kind = kind;
+      cur->obj = obj;
+      cur->opcode = opcode;
+      cur->name = name;
+      cur->calls = 1;
+      cur->samples = 0;
+      cur->next = profile_table[hash & profile_mask];
+      profile_table[hash & profile_mask] = cur;
+
+      profile_count += 1;
+      if (profile_count > profile_mask)
+	    profile_rehash();
+
+      return cur;
+}
+
+struct profile_bucket_s* profile_opcode(struct __vpiScope*scope,
+					profile_opcode_fun opcode)
+{
+      return profile_lookup(PROFILE_OPCODE, scope, opcode, 0);
+}
+
+struct profile_bucket_s* profile_functor(const vvp_net_fun_t*fun)
+{
+      return profile_lookup(PROFILE_FUNCTOR, &typeid(*fun), 0, 0);
+}
+
+struct profile_bucket_s* profile_vpi_call(struct __vpiScope*scope,
+					  const char*name)
+{
+      return profile_lookup(PROFILE_VPI_CALL, scope, 0, name);
+}
+
+struct profile_bucket_s* profile_callback(int reason)
+{
+      const char*name;
+      switch (reason) {
+	  case cbValueChange:
+	    name = "cbValueChange";
+	    break;
+	  case cbReadWriteSynch:
+	    name = "cbReadWriteSynch";
+	    break;
+	  case cbReadOnlySynch:
+	    name = "cbReadOnlySynch";
+	    break;
+	  case cbAtStartOfSimTime:
+	    name = "cbAtStartOfSimTime";
+	    break;
+	  case cbNextSimTime:
+	    name = "cbNextSimTime";
+	    break;
+	  case cbAfterDelay:
+	    name = "cbAfterDelay";
+	    break;
+	  default:
+	    name = "cbOther";
+	    break;
+      }
+      return profile_lookup(PROFILE_CALLBACK, 0, 0, name);
+}
+
+#ifdef HAVE_SETITIMER
+static void profile_tick(int)
+{
+      struct profile_bucket_s*cur = profile_current;
+      if (cur)
+	    cur->samples += 1;
+      else
+	    profile_other += 1;
+}
+#endif
+
+void profile_start(const char*path)
+{
+      profile_path = path;
+      profile_mask = 4095;
+      profile_table = new struct profile_bucket_s*[profile_mask+1];
+      memset(profile_table, 0, (profile_mask+1) * sizeof(*profile_table));
+      profile_active = true;
+
+#ifdef HAVE_SETITIMER
+      struct sigaction sa;
+      memset(&sa, 0, sizeof sa);
+      sa.sa_handler = &profile_tick;
+      sa.sa_flags = SA_RESTART;
+      sigemptyset(&sa.sa_mask);
+      sigaction(SIGPROF, &sa, 0);
+
+      struct itimerval tv;
+      tv.it_interval.tv_sec = 0;
+      tv.it_interval.tv_usec = profile_period;
+      tv.it_value = tv.it_interval;
+      setitimer(ITIMER_PROF, &tv, 0);
+#endif
+}
+
+/*
+ * Report generation. None of this is time critical.
+ */
+struct profile_row_s {
+      std::string name;
+      unsigned long calls;
+      unsigned long samples;
+
+      profile_row_s() : calls(0), samples(0) { }
+};
+
+static bool profile_row_cmp(const profile_row_s&a, const profile_row_s&b)
+{
+      if (a.samples != b.samples)
+	    return a.samples > b.samples;
+      if (a.calls != b.calls)
+	    return a.calls > b.calls;
+      return a.name < b.name;
+}
+
+  /* The folded stack format uses ';' between frames and a space
+     before the count, so keep those out of the frame names. */
+static std::string profile_frame(const char*txt)
+{
+      std::string res = txt;
+      for (size_t idx = 0 ; idx < res.size() ; idx += 1) {
+	    if (res[idx] == ';' || res[idx] == ' ')
+		  res[idx] = '_';
+      }
+      return res;
+}
+
+static std::string profile_scope_name(const struct __vpiScope*scope,
+				      bool folded)
+{
+      if (scope == 0)
+	    return "(root)";
+
+      std::string res = folded? profile_frame(scope->name) : scope->name;
+      for (scope = scope->scope ; scope ; scope = scope->scope) {
+	    if (folded)
+		  res = profile_frame(scope->name) + ";" + res;
+	    else
+		  res = std::string(scope->name) + "." + res;
+      }
+      return res;
+}
+
+static std::string profile_type_name(const void*obj)
+{
+      const char*name = ((const std::type_info*)obj)->name();
+#ifdef __GNUC__
+      int status = 0;
+      char*buf = abi::__cxa_demangle(name, 0, 0, &status);
+      if (buf && status == 0) {
+	    std::string res = buf;
+	    free(buf);
+	    return res;
+      }
+      free(buf);
+#endif
+      return name;
+}
+
+static void profile_print(const char*title, const char*what,
+			  std::map<std::string,profile_row_s>&rows,
+			  unsigned long total)
+{
+      if (rows.empty())
+	    return;
+
+      std::vector<profile_row_s> list;
+      list.reserve(rows.size());
+      for (std::map<std::string,profile_row_s>::iterator cur = rows.begin()
+		 ; cur != rows.end() ; ++ cur)
+	    list.push_back(cur->second);
+      std::sort(list.begin(), list.end(), profile_row_cmp);
+
+      const size_t limit = 20;
+      vpi_mcd_printf(1, "  %s (%lu):\n", title, (unsigned long)list.size());
+      vpi_mcd_printf(1, "    %8s %6s %12s  %s\n", "samples", "%", what, "name");
+      for (size_t idx = 0 ; idx < list.size() && idx < limit ; idx += 1) {
+	    double pct = total? 100.0 * list[idx].samples / total : 0.0;
+	    vpi_mcd_printf(1, "    %8lu %6.2f %12lu  %s\n", list[idx].samples,
+			   pct, list[idx].calls, list[idx].name.c_str());
+      }
+      if (list.size() > limit)
+	    vpi_mcd_printf(1, "    ... %lu more\n",
+			   (unsigned long)(list.size() - limit));
+}
+
+void profile_finish(void)
+{
+      if (! profile_active)
+	    return;
+
+#ifdef HAVE_SETITIMER
+      struct itimerval tv;
+      memset(&tv, 0, sizeof tv);
+      setitimer(ITIMER_PROF, &tv, 0);
+      signal(SIGPROF, SIG_IGN);
+#endif
+      profile_active = false;
+      profile_current = 0;
+
+      std::map<std::string,profile_row_s> by_scope, by_type, by_opcode,
+	    by_functor, by_task, by_callback;
+      std::map<std::string,unsigned long> folded;
+
+      unsigned long total = profile_other;
+      if (profile_other)
+	    folded["(scheduler)"] += profile_other;
+
+      for (unsigned long idx = 0 ; idx <= profile_mask ; idx += 1) {
+	    for (struct profile_bucket_s*cur = profile_table[idx]
+		       ; cur ; cur = cur->next) {
+		  const struct __vpiScope*scope =
+			(const struct __vpiScope*)cur->obj;
+		  std::string name, frame;
+		  total += cur->samples;
+
+		  switch (cur->kind) {
+		      case PROFILE_OPCODE:
+			name = codespace_opcode_name(cur->opcode);
+			frame = profile_scope_name(scope, true) + ";" + name;
+			break;
+		      case PROFILE_VPI_CALL:
+			name = cur->name;
+			frame = profile_scope_name(scope, true) + ";" + name;
+			break;
+		      case PROFILE_FUNCTOR:
+			name = profile_type_name(cur->obj);
+			frame = "(nets);" + profile_frame(name.c_str());
+			break;
+		      case PROFILE_CALLBACK:
+			name = cur->name;
+			frame = "(callbacks);" + name;
+			break;
+		  }
+
+		  if (cur->samples)
+			folded[frame] += cur->samples;
+
+		  profile_row_s*row = 0;
+		  switch (cur->kind) {
+		      case PROFILE_OPCODE:
+			row = &by_opcode[name];
+			break;
+		      case PROFILE_VPI_CALL:
+			row = &by_task[name];
+			break;
+		      case PROFILE_FUNCTOR:
+			row = &by_functor[name];
+			break;
+		      case PROFILE_CALLBACK:
+			row = &by_callback[name];
+			break;
+		  }
+		  row->name = name;
+		  row->calls += cur->calls;
+		  row->samples += cur->samples;
+
+		  if (cur->kind == PROFILE_OPCODE
+		      || cur->kind == PROFILE_VPI_CALL) {
+			std::string sname = profile_scope_name(scope, false);
+			row = &by_scope[sname];
+			row->name = sname;
+			row->calls += cur->calls;
+			row->samples += cur->samples;
+
+			std::string tname = scope? scope->tname : "(root)";
+			row = &by_type[tname];
+			row->name = tname;
+			row->calls += cur->calls;
+			row->samples += cur->samples;
+		  }
+	    }
+      }
+
+#ifdef HAVE_SETITIMER
+      vpi_mcd_printf(1, "Profile: %lu samples, %lu in the scheduler\n",
+		     total, (unsigned long)profile_other);
+#else
+      vpi_mcd_printf(1, "Profile: sampling not supported, counts only\n");
+#endif
+      profile_print("Scopes", "executed", by_scope, total);
+      profile_print("Module types", "executed", by_type, total);
+      profile_print("Opcodes", "executed", by_opcode, total);
+      profile_print("Net functors", "calls", by_functor, total);
+      profile_print("System tasks/functions", "calls", by_task, total);
+      profile_print("VPI callbacks", "calls", by_callback, total);
+
+      if (profile_path == 0)
+	    return;
+
+      FILE*fd = fopen(profile_path, "w");
+      if (fd == 0) {
+	    vpi_mcd_printf(1, "%s: Unable to open profile output file.\n",
+			   profile_path);
+	    return;
+      }
+      for (std::map<std::string,unsigned long>::iterator cur = folded.begin()
+		 ; cur != folded.end() ; ++ cur)
+	    fprintf(fd, "%s %lu\n", cur->first.c_str(), cur->second);
+      fclose(fd);
+}
@@ -0,0 +1,95 @@
+#ifndef __profile_H
+#define __profile_H
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/*
+ * The -P flag turns on the run time profiler. The profiler charges
+ * the CPU time of the simulation to the parts of the design that
+ * used it: thread code by scope and opcode, net functors by type,
+ * system tasks and functions by name, and VPI callbacks by reason.
+ *
+ * Time is measured by sampling. A profiling timer interrupts the
+ * process periodically and the signal handler charges the sample to
+ * the bucket that profile_current points at. The simulator only has
+ * to keep that pointer up to date, which is cheap enough to do for
+ * every instruction and every functor call. Looking up a bucket also
+ * counts the entry, so each bucket has an exact call count as well.
+ *
+ * None of this costs anything but a test of profile_active when the
+ * profiler is off.
+ */
+
+class vvp_net_fun_t;
+struct __vpiScope;
+struct vthread_s;
+struct vvp_code_s;
+
+struct profile_bucket_s;
+
+extern bool profile_active;
+extern struct profile_bucket_s*volatile profile_current;
+
+/*
+ * Start sampling, and stop sampling and report. The report is
+ * printed to the log, and the samples are also written to the path
+ * as folded stacks (one "frame;frame;frame count" line per stack)
+ * that flame graph tools can read directly.
+ */
+extern void profile_start(const char*path);
+extern void profile_finish(void);
+
+/*
+ * Get the bucket for the given thing, and count the call.
+ */
+extern struct profile_bucket_s* profile_opcode(struct __vpiScope*scope,
+				   bool (*opcode)(struct vthread_s*,
+						  struct vvp_code_s*));
+extern struct profile_bucket_s* profile_functor(const vvp_net_fun_t*fun);
+extern struct profile_bucket_s* profile_vpi_call(struct __vpiScope*scope,
+						 const char*name);
+extern struct profile_bucket_s* profile_callback(int reason);
+
+/*
+ * Charge the time from construction to destruction to the bucket,
+ * then go back to charging whatever was being charged before. A nil
+ * bucket makes this a no-op, so the usual use is:
+ *
+ *    profile_enter_t prof (profile_active? profile_functor(fun) : 0);
+ */
+class profile_enter_t {
+
+    public:
+      explicit profile_enter_t(struct profile_bucket_s*bucket)
+      : bucket_(bucket), save_(0)
+      { if (bucket_) { save_ = profile_current; profile_current = bucket_; } }
+
+      ~profile_enter_t()
+      { if (bucket_) profile_current = save_; }
+
+    private:
+      struct profile_bucket_s*bucket_;
+      struct profile_bucket_s*save_;
+
+    private: // not implemented
+      profile_enter_t(const profile_enter_t&);
+      profile_enter_t& operator= (const profile_enter_t&);
+};
+
+#endif
@@ -44,6 +44,7 @@ class vvp_reduce_base : public vvp_net_fun_t {
                         vvp_context_t context);
 
       virtual vvp_bit4_t calculate_result() const =0;
+      bool local_only(void) const { return true; }
 
     protected:
       vvp_vector4_t bits_;
@@ -22,11 +22,16 @@
 # include  "vpi_priv.h"
 # include  "slab.h"
 # include  "compile.h"
+# include  "statistics.h"
+# include  "profile.h"
 # include  <new>
 # include  <typeinfo>
 # include  <csignal>
 # include  <cstdlib>
 # include  <cassert>
+# include  <vector>
+# include  <algorithm>
+# include  <pthread.h>
 
 # include  <iostream>
 
@@ -35,6 +40,20 @@ unsigned long count_gen_events = 0;
 unsigned long count_thread_events = 0;
   // Count the time events (A time cell created)
 unsigned long count_time_events = 0;
+  // Count the assign events that were merged into a pending event
+unsigned long count_coalesced_events = 0;
+  // Count the partition batches, and the events that ran in them
+unsigned long count_partition_runs = 0;
+unsigned long count_partition_events = 0;
+
+bool schedule_coalesce = false;
+
+/*
+ * The coalesce table (see below) is only good for the nbassign lists
+ * that existed at the time it was filled. Bumping the generation
+ * forgets everything in the table.
+ */
+static unsigned long coalesce_gen = 1;
 
 
 
@@ -53,6 +72,14 @@ struct event_s {
       virtual ~event_s() { }
       virtual void run_run(void) =0;
 
+	// If the event only touches the nets of one local partition,
+	// count it and return the number of the partition. The
+	// scheduler may then run it on a partition thread with
+	// run_partition(). Otherwise return 0, and the event is run
+	// with run_run() as usual.
+      virtual unsigned long take_partition(void);
+      virtual void run_partition(void);
+
 	// Write something about the event to stderr
       virtual void single_step_display(void);
 
@@ -61,6 +88,16 @@ struct event_s {
       static void operator delete(void*ptr)  { ::delete[]( (char*)ptr ); }
 };
 
+unsigned long event_s::take_partition(void)
+{
+      return 0;
+}
+
+void event_s::run_partition(void)
+{
+      run_run();
+}
+
 void event_s::single_step_display(void)
 {
       cerr << "event_s: Step into event " << typeid(*this).name() << endl;
@@ -77,6 +114,8 @@ struct event_time_s {
 	    del_thr = 0;
       }
       vvp_time64_t delay;
+	// Absolute time of this cell. Only used by the time wheel.
+      vvp_time64_t wheel_time;
 
       struct event_s*start;
       struct event_s*active;
@@ -100,6 +139,11 @@ void vvp_gen_event_s::single_step_display(void)
       cerr << "vvp_gen_event_s: Step into event " << typeid(*this).name() << endl;
 }
 
+vvp_net_t* vvp_gen_event_s::partition_net(void)
+{
+      return 0;
+}
+
 /*
  * Derived event types
  */
@@ -159,7 +203,9 @@ void del_thr_event_s::single_step_display(void)
 }
 
 struct assign_vector4_event_s  : public event_s {
-	/* The default constructor. */
+	/* The default constructor. The val is swapped in later. */
+      assign_vector4_event_s() { }
+	/* A constructor that copies the val. */
       assign_vector4_event_s(const vvp_vector4_t&that) : val(that) { }
 	/* A constructor that makes the val directly. */
       assign_vector4_event_s(const vvp_vector4_t&that, unsigned adr, unsigned wid)
@@ -174,6 +220,8 @@ struct assign_vector4_event_s  : public event_s {
 	/* Width of the destination vector. */
       unsigned vwid;
       void run_run(void);
+      unsigned long take_partition(void);
+      void run_partition(void);
       void single_step_display(void);
 
       static void* operator new(size_t);
@@ -183,6 +231,19 @@ struct assign_vector4_event_s  : public event_s {
 void assign_vector4_event_s::run_run(void)
 {
       count_assign_events += 1;
+      assign_vector4_event_s::run_partition();
+}
+
+unsigned long assign_vector4_event_s::take_partition(void)
+{
+      unsigned long part = ptr.ptr()->local_partition();
+      if (part)
+	    count_assign_events += 1;
+      return part;
+}
+
+void assign_vector4_event_s::run_partition(void)
+{
       if (vwid > 0)
 	    vvp_send_vec4_pv(ptr, val, base, val.size(), vwid, 0);
       else
@@ -323,7 +384,9 @@ unsigned long count_assign_aword_pool(void) { return array_w_heap.pool; }
  * vvp_net_t object.
  */
 struct propagate_vector4_event_s : public event_s {
-	/* The default constructor. */
+	/* The default constructor. The val is swapped in later. */
+      propagate_vector4_event_s() { }
+	/* A constructor that copies the val. */
       propagate_vector4_event_s(const vvp_vector4_t&that) : val(that) { }
 	/* A constructor that makes the val directly. */
       propagate_vector4_event_s(const vvp_vector4_t&that, unsigned adr, unsigned wid)
@@ -335,6 +398,7 @@ struct propagate_vector4_event_s : public event_s {
       vvp_vector4_t val;
 	/* Action */
       void run_run(void);
+      unsigned long take_partition(void);
       void single_step_display(void);
 };
 
@@ -343,6 +407,11 @@ void propagate_vector4_event_s::run_run(void)
       net->send_vec4(val, 0);
 }
 
+unsigned long propagate_vector4_event_s::take_partition(void)
+{
+      return net->local_partition();
+}
+
 void propagate_vector4_event_s::single_step_display(void)
 {
       cerr << "propagate_vector4_event: Propagate val=" << val << endl;
@@ -407,6 +476,8 @@ struct generic_event_s : public event_s {
       vvp_gen_event_t obj;
       bool delete_obj_when_done;
       void run_run(void);
+      unsigned long take_partition(void);
+      void run_partition(void);
       void single_step_display(void);
 
       static void* operator new(size_t);
@@ -423,6 +494,23 @@ void generic_event_s::run_run(void)
       }
 }
 
+unsigned long generic_event_s::take_partition(void)
+{
+      if (obj == 0 || delete_obj_when_done)
+	    return 0;
+
+      vvp_net_t*net = obj->partition_net();
+      unsigned long part = net? net->local_partition() : 0;
+      if (part)
+	    count_gen_events += 1;
+      return part;
+}
+
+void generic_event_s::run_partition(void)
+{
+      obj->run_run();
+}
+
 void generic_event_s::single_step_display(void)
 {
       obj->single_step_display();
@@ -474,6 +562,288 @@ unsigned long count_time_pool(void) { return event_time_heap.pool; }
  */
 static struct event_time_s* sched_list = 0;
 
+/*
+ * The list above must be walked to find the place for each new time
+ * step, and that gets expensive when there are many distinct pending
+ * times (i.e. gate level netlists with lots of different delays). The
+ * time wheel is a hierarchical timing wheel that is used instead of
+ * the list unless schedule_use_wheel is cleared before any events
+ * are scheduled.
+ *
+ * The wheel has WHEEL_LEVELS levels of WHEEL_SLOTS buckets each. Each
+ * level is indexed by one WHEEL_BITS wide digit of the absolute time
+ * of the event_time_s cell, and the level of a cell is the most
+ * significant digit where its time differs from wheel_now. So level 0
+ * holds the cells that share all but the last digit with the current
+ * time, and each of those buckets holds at most one cell. The higher
+ * level buckets hold lists of cells (in the order they were created)
+ * that are cascaded down to the lower levels when wheel_now reaches
+ * the bucket. A bitmap of the occupied buckets per level makes it
+ * quick to find the next non-empty bucket.
+ */
+bool schedule_use_wheel = true;
+
+static const unsigned WHEEL_BITS = 8;
+static const unsigned WHEEL_SLOTS = 1 << WHEEL_BITS;
+static const unsigned WHEEL_LEVELS = (64 + WHEEL_BITS - 1) / WHEEL_BITS;
+static const unsigned WHEEL_MAP_BITS = 8 * sizeof(unsigned long);
+static const unsigned WHEEL_MAP_WORDS = WHEEL_SLOTS / WHEEL_MAP_BITS;
+
+static struct event_time_s* wheel_head[WHEEL_LEVELS][WHEEL_SLOTS];
+static struct event_time_s* wheel_tail[WHEEL_LEVELS][WHEEL_SLOTS];
+static unsigned long wheel_map[WHEEL_LEVELS][WHEEL_MAP_WORDS];
+static unsigned wheel_occupied[WHEEL_LEVELS];
+static vvp_time64_t wheel_now = 0;
+  // This is the time step that the scheduler is working on, if any.
+static struct event_time_s* wheel_current = 0;
+
+  // Statistics for the time wheel.
+unsigned long count_wheel_cascades = 0;
+unsigned long count_wheel_peak[WHEEL_LEVELS];
+
+unsigned schedule_wheel_levels(void) { return WHEEL_LEVELS; }
+unsigned schedule_wheel_slots(void) { return WHEEL_SLOTS; }
+
+static inline unsigned wheel_level_(vvp_time64_t tim)
+{
+      vvp_time64_t diff = tim ^ wheel_now;
+      unsigned level = 0;
+      while (diff >= WHEEL_SLOTS) {
+	    diff >>= WHEEL_BITS;
+	    level += 1;
+      }
+      return level;
+}
+
+static inline unsigned wheel_slot_(vvp_time64_t tim, unsigned level)
+{
+      return (tim >> (level*WHEEL_BITS)) & (WHEEL_SLOTS-1);
+}
+
+static inline void wheel_mark_(unsigned level, unsigned slot)
+{
+      unsigned long mask = 1UL << (slot % WHEEL_MAP_BITS);
+      unsigned long&word = wheel_map[level][slot / WHEEL_MAP_BITS];
+      if (word & mask)
+	    return;
+
+      word |= mask;
+      wheel_occupied[level] += 1;
+      if (wheel_occupied[level] > count_wheel_peak[level])
+	    count_wheel_peak[level] = wheel_occupied[level];
+}
+
+static inline void wheel_unmark_(unsigned level, unsigned slot)
+{
+      wheel_map[level][slot / WHEEL_MAP_BITS] &= ~(1UL << (slot % WHEEL_MAP_BITS));
+      wheel_occupied[level] -= 1;
+}
+
+/*
+ * Return the first occupied slot at or after the given slot of the
+ * level, or WHEEL_SLOTS if there are none.
+ */
+static unsigned wheel_scan_(unsigned level, unsigned slot)
+{
+      unsigned idx = slot / WHEEL_MAP_BITS;
+      if (idx >= WHEEL_MAP_WORDS)
+	    return WHEEL_SLOTS;
+
+      unsigned long word = wheel_map[level][idx] >> (slot % WHEEL_MAP_BITS);
+      if (word == 0) {
+	    slot = 0;
+	    for (idx += 1 ; idx < WHEEL_MAP_WORDS ; idx += 1) {
+		  word = wheel_map[level][idx];
+		  if (word) break;
+	    }
+	    if (idx >= WHEEL_MAP_WORDS)
+		  return WHEEL_SLOTS;
+	    slot = idx * WHEEL_MAP_BITS;
+      }
+
+#if defined(__GNUC__)
+      return slot + __builtin_ctzl(word);
+#else
+      while ((word & 1UL) == 0) {
+	    word >>= 1;
+	    slot += 1;
+      }
+      return slot;
+#endif
+}
+
+/*
+ * Append the circular event list src to the circular event list
+ * dst. Both are pointers to the last item of their list.
+ */
+static void event_list_append_(struct event_s*&dst, struct event_s*src)
+{
+      if (src == 0)
+	    return;
+
+      if (dst != 0) {
+	    struct event_s*dst_first = dst->next;
+	    dst->next = src->next;
+	    src->next = dst_first;
+      }
+      dst = src;
+}
+
+/*
+ * Move the events of the src time step to the end of the dst time
+ * step, which is for the same time, and delete the src time step.
+ */
+static void wheel_merge_(struct event_time_s*dst, struct event_time_s*src)
+{
+      assert(dst->wheel_time == src->wheel_time);
+      event_list_append_(dst->start,    src->start);
+      event_list_append_(dst->active,   src->active);
+      event_list_append_(dst->nbassign, src->nbassign);
+      event_list_append_(dst->rwsync,   src->rwsync);
+      event_list_append_(dst->rosync,   src->rosync);
+      event_list_append_(dst->del_thr,  src->del_thr);
+      coalesce_gen += 1;
+      delete src;
+}
+
+/*
+ * Put the time step cell into the wheel. If there is already a cell
+ * for the same time in the level 0 slot, or at the end of the list
+ * of a higher level slot, then the events are merged into that cell.
+ */
+static struct event_time_s* wheel_insert_(struct event_time_s*cell)
+{
+      unsigned level = wheel_level_(cell->wheel_time);
+      unsigned slot = wheel_slot_(cell->wheel_time, level);
+      struct event_time_s*tail = wheel_tail[level][slot];
+      cell->next = 0;
+
+      if (tail == 0) {
+	    wheel_head[level][slot] = cell;
+	    wheel_tail[level][slot] = cell;
+	    wheel_mark_(level, slot);
+	    return cell;
+      }
+
+      if (tail->wheel_time == cell->wheel_time) {
+	    wheel_merge_(tail, cell);
+	    return tail;
+      }
+
+	/* Level 0 slots are for exactly one time. */
+      assert(level > 0);
+      tail->next = cell;
+      wheel_tail[level][slot] = cell;
+      return cell;
+}
+
+/*
+ * Get the time step cell for the given absolute time, creating it if
+ * needed. The time is never before wheel_now.
+ */
+static struct event_time_s* wheel_find_(vvp_time64_t tim)
+{
+      unsigned level = wheel_level_(tim);
+      unsigned slot = wheel_slot_(tim, level);
+      struct event_time_s*tail = wheel_tail[level][slot];
+      if (tail && tail->wheel_time == tim)
+	    return tail;
+
+      struct event_time_s*cell = new struct event_time_s;
+      cell->wheel_time = tim;
+      cell->delay = 0;
+      return wheel_insert_(cell);
+}
+
+/*
+ * Locate the earliest time step in the wheel and make it the current
+ * time step. If the earliest cells are in a higher level, advance
+ * wheel_now to the start of that bucket and cascade its cells down to
+ * the lower levels, which are empty, and try again.
+ */
+static struct event_time_s* wheel_next_(void)
+{
+      for (;;) {
+	    unsigned slot = wheel_scan_(0, wheel_slot_(wheel_now, 0));
+	    if (slot < WHEEL_SLOTS) {
+		  struct event_time_s*cell = wheel_head[0][slot];
+		  wheel_now = cell->wheel_time;
+		  return cell;
+	    }
+
+	    unsigned level = 1;
+	    for ( ; level < WHEEL_LEVELS ; level += 1) {
+		  slot = wheel_scan_(level, wheel_slot_(wheel_now, level) + 1);
+		  if (slot < WHEEL_SLOTS)
+			break;
+	    }
+
+	    if (level >= WHEEL_LEVELS)
+		  return 0;
+
+	    count_wheel_cascades += 1;
+
+	    unsigned shift = level * WHEEL_BITS;
+	    vvp_time64_t base = 0;
+	    if (shift + WHEEL_BITS < 64)
+		  base = (wheel_now >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS);
+	    wheel_now = base | ((vvp_time64_t)slot << shift);
+
+	    struct event_time_s*cur = wheel_head[level][slot];
+	    wheel_head[level][slot] = 0;
+	    wheel_tail[level][slot] = 0;
+	    wheel_unmark_(level, slot);
+
+	    while (cur) {
+		  struct event_time_s*next = cur->next;
+		  wheel_insert_(cur);
+		  cur = next;
+	    }
+      }
+}
+
+/*
+ * Return the time step that the scheduler is to work on next. The
+ * delay of the returned cell is relative to the current simulation
+ * time.
+ */
+static vvp_time64_t schedule_time;
+
+static struct event_time_s* schedule_head_(void)
+{
+      if (! schedule_use_wheel)
+	    return sched_list;
+
+      if (wheel_current == 0) {
+	    wheel_current = wheel_next_();
+	    if (wheel_current)
+		  wheel_current->delay = wheel_current->wheel_time - schedule_time;
+      }
+
+      return wheel_current;
+}
+
+/*
+ * Remove the (empty) head time step from the event queue.
+ */
+static void schedule_pop_head_(struct event_time_s*ctim)
+{
+      if (schedule_use_wheel) {
+	    assert(ctim == wheel_current);
+	    unsigned slot = wheel_slot_(ctim->wheel_time, 0);
+	    assert(wheel_head[0][slot] == ctim);
+	    wheel_head[0][slot] = 0;
+	    wheel_tail[0][slot] = 0;
+	    wheel_unmark_(0, slot);
+	    wheel_current = 0;
+      } else {
+	    sched_list = ctim->next;
+      }
+
+      coalesce_gen += 1;
+      delete ctim;
+}
+
 /*
  * This is a list of initialization events. The setup puts
  * initializations in this list so that they happen before the
@@ -557,11 +927,8 @@ static void schedule_init_event(struct event_s*cur)
 typedef enum event_queue_e { SEQ_START, SEQ_ACTIVE, SEQ_NBASSIGN,
 			     SEQ_RWSYNC, SEQ_ROSYNC, DEL_THREAD } event_queue_t;
 
-static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
-			    event_queue_t select_queue)
+static struct event_time_s* sched_list_find_(vvp_time64_t delay)
 {
-      cur->next = cur;
-
       struct event_time_s*ctim = sched_list;
 
       if (sched_list == 0) {
@@ -614,9 +981,25 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
 	    }
       }
 
-	/* By this point, ctim is the event_time structure that is to
-	   receive the event at hand. Put the event in to the
-	   appropriate list for the kind of assign we have at hand. */
+      return ctim;
+}
+
+static inline struct event_time_s* schedule_find_(vvp_time64_t delay)
+{
+      if (schedule_use_wheel)
+	    return wheel_find_(schedule_time + delay);
+      else
+	    return sched_list_find_(delay);
+}
+
+static void schedule_event_at_(struct event_s*cur, struct event_time_s*ctim,
+			       event_queue_t select_queue)
+{
+      cur->next = cur;
+
+	/* ctim is the event_time structure that is to receive the
+	   event at hand. Put the event in to the appropriate list for
+	   the kind of assign we have at hand. */
 
       switch (select_queue) {
 
@@ -692,15 +1075,35 @@ static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
       }
 }
 
+/*
+ * While the partition threads run a batch (see run_partitions_
+ * below), the events that they schedule are held back instead of
+ * queued.
+ */
+static bool partition_capture = false;
+static void partition_capture_event_(struct event_s*cur, vvp_time64_t delay,
+				     event_queue_t select_queue);
+
+static void schedule_event_(struct event_s*cur, vvp_time64_t delay,
+			    event_queue_t select_queue)
+{
+      if (partition_capture) {
+	    partition_capture_event_(cur, delay, select_queue);
+	    return;
+      }
+
+      schedule_event_at_(cur, schedule_find_(delay), select_queue);
+}
+
 static void schedule_event_push_(struct event_s*cur)
 {
-      if ((sched_list == 0) || (sched_list->delay > 0)) {
+      struct event_time_s*ctim = schedule_use_wheel? wheel_current : sched_list;
+
+      if ((ctim == 0) || (ctim->delay > 0)) {
 	    schedule_event_(cur, 0, SEQ_ACTIVE);
 	    return;
       }
 
-      struct event_time_s*ctim = sched_list;
-
       if (ctim->active == 0) {
 	    cur->next = cur;
 	    ctim->active = cur;
@@ -730,16 +1133,103 @@ void schedule_vthread(vthread_t thr, vvp_time64_t delay, bool push_flag)
       }
 }
 
+/*
+ * When schedule_coalesce is set, a non-blocking vec4 assign to an
+ * input that already has a pending assign of the same part in the
+ * same nbassign list is merged into the pending event: the pending
+ * event takes the new value and no new event is created. The
+ * intermediate value is never propagated, so a bus written N times
+ * in a time step is propagated once instead of N times.
+ *
+ * The coalesce table remembers, for each input, the last assign
+ * event that was put in an nbassign list for it. Merging into that
+ * event is only allowed if it is still the last event in that list
+ * for the input, and no event of another kind (array words, net
+ * propagation) was put in any nbassign list since, so the final
+ * value of every net is what it would have been without merging.
+ * Only zero-width glitches (and anything that waits on them) are
+ * lost, which is why this is optional.
+ *
+ * The table is direct mapped. A collision just forgets the older
+ * input, which is always safe.
+ */
+struct coalesce_slot_s {
+      vvp_net_ptr_t ptr;
+      struct event_time_s*ctim;
+      struct assign_vector4_event_s*event;
+      unsigned long gen;
+};
+
+static const unsigned COALESCE_SLOTS = 1024;
+static struct coalesce_slot_s coalesce_table[COALESCE_SLOTS];
+
+static inline struct coalesce_slot_s* coalesce_slot_(vvp_net_ptr_t ptr)
+{
+      unsigned long key = reinterpret_cast<unsigned long> (ptr.ptr());
+      key = (key >> 4) ^ (key >> 14) ^ ptr.port();
+      return coalesce_table + (key % COALESCE_SLOTS);
+}
+
+/*
+ * Return the pending event that an assign of wid bits at base of a
+ * vwid vector to ptr can be merged into, or nil.
+ */
+static struct assign_vector4_event_s* coalesce_find_(struct event_time_s*ctim,
+						     vvp_net_ptr_t ptr,
+						     unsigned base,
+						     unsigned vwid,
+						     unsigned wid)
+{
+      struct coalesce_slot_s*slot = coalesce_slot_(ptr);
+      if (slot->gen != coalesce_gen || slot->ctim != ctim || slot->ptr != ptr)
+	    return 0;
+
+      struct assign_vector4_event_s*cur = slot->event;
+      if (cur->base != base || cur->vwid != vwid || cur->val.size() != wid)
+	    return 0;
+
+      count_coalesced_events += 1;
+      return cur;
+}
+
+static void coalesce_note_(struct event_time_s*ctim,
+			   struct assign_vector4_event_s*cur)
+{
+      struct coalesce_slot_s*slot = coalesce_slot_(cur->ptr);
+      slot->ptr = cur->ptr;
+      slot->ctim = ctim;
+      slot->event = cur;
+      slot->gen = coalesce_gen;
+}
+
 void schedule_assign_vector(vvp_net_ptr_t ptr,
 			    unsigned base, unsigned vwid,
-			    const vvp_vector4_t&bit,
+			    vvp_vector4_t bit,
 			    vvp_time64_t delay)
 {
-      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s(bit);
+	/* Only threads make these, and they never run in a partition
+	   batch, so the event need not go through schedule_event_. */
+      assert(! partition_capture);
+      struct event_time_s*ctim = schedule_find_(delay);
+      struct assign_vector4_event_s*cur = 0;
+      if (schedule_coalesce)
+	    cur = coalesce_find_(ctim, ptr, base, vwid, bit.size());
+
+      if (cur) {
+	    cur->val.swap(bit);
+	    count_add(count_vector4_swaps);
+	    return;
+      }
+
+      cur = new struct assign_vector4_event_s;
+      cur->val.swap(bit);
+      count_add(count_vector4_swaps);
       cur->ptr = ptr;
       cur->base = base;
       cur->vwid = vwid;
-      schedule_event_(cur, delay, SEQ_NBASSIGN);
+      schedule_event_at_(cur, ctim, SEQ_NBASSIGN);
+      if (schedule_coalesce)
+	    coalesce_note_(ctim, cur);
 }
 
 void schedule_assign_plucked_vector(vvp_net_ptr_t ptr,
@@ -747,12 +1237,28 @@ void schedule_assign_plucked_vector(vvp_net_ptr_t ptr,
 				    const vvp_vector4_t&src,
 				    unsigned adr, unsigned wid)
 {
-      struct assign_vector4_event_s*cur
-	    = new struct assign_vector4_event_s(src,adr,wid);
+	/* Only threads make these, and they never run in a partition
+	   batch, so the event need not go through schedule_event_. */
+      assert(! partition_capture);
+      struct event_time_s*ctim = schedule_find_(delay);
+      struct assign_vector4_event_s*cur = 0;
+      if (schedule_coalesce)
+	    cur = coalesce_find_(ctim, ptr, 0, 0, wid);
+
+      if (cur) {
+	    vvp_vector4_t tmp (src, adr, wid);
+	    cur->val.swap(tmp);
+	    count_add(count_vector4_swaps);
+	    return;
+      }
+
+      cur = new struct assign_vector4_event_s(src,adr,wid);
       cur->ptr = ptr;
       cur->vwid = 0;
       cur->base = 0;
-      schedule_event_(cur, delay, SEQ_NBASSIGN);
+      schedule_event_at_(cur, ctim, SEQ_NBASSIGN);
+      if (schedule_coalesce)
+	    coalesce_note_(ctim, cur);
 }
 
 void schedule_propagate_plucked_vector(vvp_net_t*net,
@@ -763,6 +1269,7 @@ void schedule_propagate_plucked_vector(vvp_net_t*net,
       struct propagate_vector4_event_s*cur
 	    = new struct propagate_vector4_event_s(src,adr,wid);
       cur->net = net;
+      coalesce_gen += 1;
       schedule_event_(cur, delay, SEQ_NBASSIGN);
 }
 
@@ -776,7 +1283,9 @@ void schedule_assign_array_word(vvp_array_t mem,
       cur->mem = mem;
       cur->adr = word_addr;
       cur->off = off;
-      cur->val = val;
+      cur->val.swap(val);
+      count_add(count_vector4_swaps);
+      coalesce_gen += 1;
       schedule_event_(cur, delay, SEQ_NBASSIGN);
 }
 
@@ -789,12 +1298,15 @@ void schedule_assign_array_word(vvp_array_t mem,
       cur->mem = mem;
       cur->adr = word_addr;
       cur->val = val;
+      coalesce_gen += 1;
       schedule_event_(cur, delay, SEQ_NBASSIGN);
 }
 
-void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&bit)
+void schedule_set_vector(vvp_net_ptr_t ptr, vvp_vector4_t bit)
 {
-      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s(bit);
+      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s;
+      cur->val.swap(bit);
+      count_add(count_vector4_swaps);
       cur->ptr = ptr;
       cur->base = 0;
       cur->vwid = 0;
@@ -819,7 +1331,9 @@ void schedule_set_vector(vvp_net_ptr_t ptr, double bit)
 
 void schedule_init_vector(vvp_net_ptr_t ptr, vvp_vector4_t bit)
 {
-      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s(bit);
+      struct assign_vector4_event_s*cur = new struct assign_vector4_event_s;
+      cur->val.swap(bit);
+      count_add(count_vector4_swaps);
       cur->ptr = ptr;
       cur->base = 0;
       cur->vwid = 0;
@@ -844,7 +1358,9 @@ void schedule_init_vector(vvp_net_ptr_t ptr, double bit)
 
 void schedule_init_propagate(vvp_net_t*net, vvp_vector4_t bit)
 {
-      struct propagate_vector4_event_s*cur = new struct propagate_vector4_event_s(bit);
+      struct propagate_vector4_event_s*cur = new struct propagate_vector4_event_s;
+      cur->val.swap(bit);
+      count_add(count_vector4_swaps);
       cur->net = net;
       schedule_init_event(cur);
 }
@@ -904,7 +1420,6 @@ void schedule_at_start_of_simtime(vvp_gen_event_t obj, vvp_time64_t delay)
       schedule_event_(cur, delay, SEQ_START);
 }
 
-static vvp_time64_t schedule_time;
 vvp_time64_t schedule_simtime(void)
 { return schedule_time; }
 
@@ -955,6 +1470,270 @@ static void run_rosync(struct event_time_s*ctim)
       }
 }
 
+/*
+ * With schedule_threads > 1 (vvp -j), the scheduler takes the events
+ * at the front of the active queue that each stay within one local
+ * partition of the net, and runs them as a batch. The events of each
+ * partition run in queue order on one thread, and different
+ * partitions run on different threads. The partitions share no nets,
+ * so this is the same as running the events one at a time, as long
+ * as the events that they schedule are put into the queues in the
+ * same order. So those are captured with the index in the batch of
+ * the event that scheduled them, and after the batch are queued in
+ * index order. The slab heaps are locked while a batch runs.
+ *
+ * The first event that is not in a local partition ends the batch. A
+ * batch with too few events or only one partition is just run here.
+ */
+unsigned schedule_threads = 1;
+bool slab_locked = false;
+
+static const size_t partition_batch_min = 16;
+
+struct partition_capture_s {
+	// The index in the batch of the event that scheduled this.
+      size_t index;
+      struct event_s*event;
+      vvp_time64_t delay;
+      event_queue_t select_queue;
+};
+
+static bool capture_index_less_(const partition_capture_s&a,
+				const partition_capture_s&b)
+{
+      return a.index < b.index;
+}
+
+struct partition_thread_s {
+      pthread_t thread;
+	// The index in the batch of the event being run.
+      size_t current;
+      std::vector<partition_capture_s> captured;
+};
+
+  // The thread objects. The first is the scheduler thread itself.
+static std::vector<partition_thread_s*> partition_threads;
+static pthread_key_t partition_key;
+static pthread_mutex_t partition_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t partition_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t partition_done = PTHREAD_COND_INITIALIZER;
+  // Each batch is a new round. The threads still working on it are
+  // busy, and next_group is the next group to be taken.
+static unsigned long partition_round = 0;
+static unsigned partition_busy = 0;
+static size_t partition_next_group = 0;
+static bool partition_quit = false;
+
+  // The number of local partitions, 0 until they are numbered.
+static unsigned long partition_count = 0;
+  // The events of the batch in queue order, and the indices of the
+  // events of each partition, one group per partition.
+static std::vector<struct event_s*> partition_batch;
+static std::vector< std::vector<size_t> > partition_groups;
+static size_t partition_group_count = 0;
+  // By partition number, the group of the partition in the batch
+  // that partition_stamp says it was last seen in.
+static std::vector<size_t> partition_group_of;
+static std::vector<unsigned long> partition_stamp;
+static unsigned long partition_batch_stamp = 0;
+
+static void partition_capture_event_(struct event_s*cur, vvp_time64_t delay,
+				     event_queue_t select_queue)
+{
+      partition_thread_s*self = (partition_thread_s*)
+	    pthread_getspecific(partition_key);
+      assert(self);
+
+      partition_capture_s item;
+      item.index = self->current;
+      item.event = cur;
+      item.delay = delay;
+      item.select_queue = select_queue;
+      self->captured.push_back(item);
+}
+
+static void run_partition_groups_(partition_thread_s*self)
+{
+      for (;;) {
+	    pthread_mutex_lock(&partition_mutex);
+	    size_t grp = partition_next_group++;
+	    pthread_mutex_unlock(&partition_mutex);
+	    if (grp >= partition_group_count)
+		  break;
+
+	    std::vector<size_t>&group = partition_groups[grp];
+	    for (size_t idx = 0 ;  idx < group.size() ;  idx += 1) {
+		  self->current = group[idx];
+		  partition_batch[group[idx]]->run_partition();
+	    }
+      }
+}
+
+static void* partition_thread_(void*arg)
+{
+      partition_thread_s*self = (partition_thread_s*)arg;
+      pthread_setspecific(partition_key, self);
+
+      unsigned long round = 0;
+      pthread_mutex_lock(&partition_mutex);
+      for (;;) {
+	    while (partition_round == round && !partition_quit)
+		  pthread_cond_wait(&partition_start, &partition_mutex);
+	    if (partition_quit)
+		  break;
+	    round = partition_round;
+	    pthread_mutex_unlock(&partition_mutex);
+
+	    run_partition_groups_(self);
+
+	    pthread_mutex_lock(&partition_mutex);
+	    partition_busy -= 1;
+	    if (partition_busy == 0)
+		  pthread_cond_signal(&partition_done);
+      }
+      pthread_mutex_unlock(&partition_mutex);
+      return 0;
+}
+
+static void start_partition_threads_(void)
+{
+      pthread_key_create(&partition_key, 0);
+
+      partition_thread_s*self = new partition_thread_s;
+      pthread_setspecific(partition_key, self);
+      partition_threads.push_back(self);
+
+	/* If a thread cannot be started, run with the ones that
+	   could. The scheduler thread always takes part. */
+      for (unsigned idx = 1 ;  idx < schedule_threads ;  idx += 1) {
+	    partition_thread_s*cur = new partition_thread_s;
+	    if (pthread_create(&cur->thread, 0, partition_thread_, cur) != 0) {
+		  delete cur;
+		  break;
+	    }
+	    partition_threads.push_back(cur);
+      }
+}
+
+static void stop_partition_threads_(void)
+{
+      if (partition_threads.empty())
+	    return;
+
+      pthread_mutex_lock(&partition_mutex);
+      partition_quit = true;
+      pthread_cond_broadcast(&partition_start);
+      pthread_mutex_unlock(&partition_mutex);
+
+      for (size_t idx = 1 ;  idx < partition_threads.size() ;  idx += 1)
+	    pthread_join(partition_threads[idx]->thread, 0);
+      for (size_t idx = 0 ;  idx < partition_threads.size() ;  idx += 1)
+	    delete partition_threads[idx];
+      partition_threads.clear();
+}
+
+static void run_partition_batch_(void)
+{
+      if (partition_threads.empty())
+	    start_partition_threads_();
+
+      pthread_mutex_lock(&partition_mutex);
+      partition_next_group = 0;
+      partition_busy = partition_threads.size() - 1;
+      partition_round += 1;
+      partition_capture = true;
+      slab_locked = true;
+      count_shared = true;
+      pthread_cond_broadcast(&partition_start);
+      pthread_mutex_unlock(&partition_mutex);
+
+      run_partition_groups_(partition_threads[0]);
+
+      pthread_mutex_lock(&partition_mutex);
+      while (partition_busy > 0)
+	    pthread_cond_wait(&partition_done, &partition_mutex);
+      partition_capture = false;
+      slab_locked = false;
+      count_shared = false;
+      pthread_mutex_unlock(&partition_mutex);
+
+	/* Queue the captured events in the order that running the
+	   batch one event at a time would have queued them. Each
+	   event ran on one thread, so its captures are in order. */
+      std::vector<partition_capture_s> captured;
+      for (size_t idx = 0 ;  idx < partition_threads.size() ;  idx += 1) {
+	    std::vector<partition_capture_s>&cur = partition_threads[idx]->captured;
+	    captured.insert(captured.end(), cur.begin(), cur.end());
+	    cur.clear();
+      }
+      std::stable_sort(captured.begin(), captured.end(), capture_index_less_);
+      for (size_t idx = 0 ;  idx < captured.size() ;  idx += 1)
+	    schedule_event_(captured[idx].event, captured[idx].delay,
+			    captured[idx].select_queue);
+
+      count_partition_runs += 1;
+      count_partition_events += partition_batch.size();
+}
+
+/*
+ * Take the local partition events from the front of the active list
+ * and run them. Return false if the first event is not one of them.
+ */
+static bool run_partitions_(struct event_time_s*ctim)
+{
+      if (vvp_net_t::partitions_stale) {
+	    partition_count = vvp_net_t::number_partitions();
+	    partition_group_of.resize(partition_count+1);
+	    partition_stamp.assign(partition_count+1, 0);
+	    partition_batch_stamp = 0;
+      }
+      if (partition_count < 2)
+	    return false;
+
+      partition_batch_stamp += 1;
+      partition_batch.clear();
+      partition_group_count = 0;
+      while (ctim->active) {
+	    struct event_s*cur = ctim->active->next;
+	    unsigned long part = cur->take_partition();
+	    if (part == 0)
+		  break;
+
+	    if (cur->next == cur) {
+		  ctim->active = 0;
+	    } else {
+		  ctim->active->next = cur->next;
+	    }
+
+	    if (partition_stamp[part] != partition_batch_stamp) {
+		  partition_stamp[part] = partition_batch_stamp;
+		  partition_group_of[part] = partition_group_count;
+		  if (partition_groups.size() <= partition_group_count)
+			partition_groups.resize(partition_group_count+1);
+		  partition_groups[partition_group_count].clear();
+		  partition_group_count += 1;
+	    }
+	    partition_groups[partition_group_of[part]]
+		  .push_back(partition_batch.size());
+	    partition_batch.push_back(cur);
+      }
+
+      if (partition_batch.empty())
+	    return false;
+
+      if (partition_group_count < 2
+	  || partition_batch.size() < partition_batch_min) {
+	    for (size_t idx = 0 ;  idx < partition_batch.size() ;  idx += 1)
+		  partition_batch[idx]->run_partition();
+      } else {
+	    run_partition_batch_();
+      }
+
+      for (size_t idx = 0 ;  idx < partition_batch.size() ;  idx += 1)
+	    delete partition_batch[idx];
+      return true;
+}
+
 void schedule_simulate(void)
 {
       sim_started = false;
@@ -999,7 +1778,7 @@ void schedule_simulate(void)
 	    vpi_mcd_printf(1, " ...run scheduler\n");
       }
 
-      if (schedule_runnable) while (sched_list) {
+      if (schedule_runnable) for (;;) {
 
 	    if (schedule_stopped_flag) {
 		  schedule_stopped_flag = false;
@@ -1010,7 +1789,8 @@ void schedule_simulate(void)
 	    }
 
 	      /* ctim is the current time step. */
-	    struct event_time_s* ctim = sched_list;
+	    struct event_time_s* ctim = schedule_head_();
+	    if (ctim == 0) break;
 
 	      /* If the time is advancing, then first run the
 		 postponed sync events. Run them all. */
@@ -1041,6 +1821,7 @@ void schedule_simulate(void)
 	    if (ctim->active == 0) {
 		  ctim->active = ctim->nbassign;
 		  ctim->nbassign = 0;
+		  coalesce_gen += 1;
 
 		  if (ctim->active == 0) {
 			ctim->active = ctim->rwsync;
@@ -1051,13 +1832,18 @@ void schedule_simulate(void)
 			     deletes threads as needed. */
 			if (ctim->active == 0) {
 			      run_rosync(ctim);
-			      sched_list = ctim->next;
-			      delete ctim;
+			      schedule_pop_head_(ctim);
 			      continue;
 			}
 		  }
 	    }
 
+	      /* With partition threads, run the local partition
+		 events at the front of the list as a batch. */
+	    if (schedule_threads > 1 && !schedule_single_step_flag
+		&& !profile_active && run_partitions_(ctim))
+		  continue;
+
 	      /* Pull the first item off the list. If this is the last
 		 cell in the list, then clear the list. Execute that
 		 event type, and delete it. */
@@ -1080,6 +1866,7 @@ void schedule_simulate(void)
       }
 
 
+      stop_partition_threads_();
       signals_revert();
 
       if (verbose_flag) {
@@ -40,10 +40,14 @@ extern void schedule_vthread(vthread_t thr, vvp_time64_t delay,
  * the specified input when the delay times out. This is scheduled
  * like a non-blocking assignment. This is in fact mostly used to
  * implement the non-blocking assignment.
+ *
+ * The vec4 val arguments of these functions are passed by value and
+ * swapped into the event, so a caller that passes a temporary hands
+ * over the value without another copy.
  */
 extern void schedule_assign_vector(vvp_net_ptr_t ptr,
 				   unsigned base, unsigned vwid,
-				   const vvp_vector4_t&val,
+				   vvp_vector4_t val,
 				   vvp_time64_t  delay);
 
 extern void schedule_assign_plucked_vector(vvp_net_ptr_t ptr,
@@ -75,7 +79,7 @@ extern void schedule_propagate_plucked_vector(vvp_net_t*ptr,
  * constant value (i.e. C4<...>) to the input of a functor. This
  * creates an event in the active queue.
  */
-extern void schedule_set_vector(vvp_net_ptr_t ptr, const vvp_vector4_t&val);
+extern void schedule_set_vector(vvp_net_ptr_t ptr, vvp_vector4_t val);
 extern void schedule_set_vector(vvp_net_ptr_t ptr, vvp_vector8_t val);
 extern void schedule_set_vector(vvp_net_ptr_t ptr, double val);
 
@@ -142,6 +146,9 @@ struct vvp_gen_event_s
       virtual ~vvp_gen_event_s() =0;
       virtual void run_run() =0;
       virtual void single_step_display(void);
+	// A local_only() functor that schedules itself returns its own
+	// net here, so that the event can run in its partition.
+      virtual vvp_net_t* partition_net(void);
 };
 
 /*
@@ -178,6 +185,30 @@ extern bool schedule_stopped(void);
  */
 extern void stop_handler(int rc);
 
+/*
+ * The scheduler keeps the future time steps in a hierarchical time
+ * wheel. Clearing this flag (before anything is scheduled) makes it
+ * use the original sorted list of time steps instead.
+ */
+extern bool schedule_use_wheel;
+
+/*
+ * Setting this flag makes repeated non-blocking assigns to the same
+ * net in the same time step merge into a single event, so only the
+ * last value is propagated. This loses zero-width glitches.
+ */
+extern bool schedule_coalesce;
+
+/*
+ * With more than one schedule thread (vvp -j), runs of active events
+ * that each stay within a local partition of the net (see
+ * vvp_net_t::number_partitions) are run on that many threads, one
+ * partition per thread at a time. The events that they schedule are
+ * held back and then queued in the order that running the events one
+ * at a time would have queued them, so the simulation is the same.
+ */
+extern unsigned schedule_threads;
+
 /*
  * These are event counters for the sake of performance measurements.
  */
@@ -21,6 +21,16 @@
  */
 
 
+# include  <pthread.h>
+
+/*
+ * The slab heaps are not normally locked. While the scheduler runs
+ * partitions of the net on several threads (vvp -j) it sets
+ * slab_locked, and then every alloc_slab and free_slab holds the lock
+ * of its heap.
+ */
+extern bool slab_locked;
+
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
 
       union item_cell_u {
@@ -37,6 +47,11 @@ template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
       unsigned long pool;
 
     private:
+      void* alloc_slab_();
+      void  free_slab_(void*);
+
+    private:
+      pthread_mutex_t lock_;
       item_cell_u*heap_;
       item_cell_u initial_chunk_[CHUNK_COUNT];
 };
@@ -44,6 +59,7 @@ template <size_t SLAB_SIZE, size_t CHUNK_COUNT> class slab_t {
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
 slab_t<SLAB_SIZE,CHUNK_COUNT>::slab_t()
 {
+      pthread_mutex_init(&lock_, 0);
       pool = CHUNK_COUNT;
       heap_ = initial_chunk_;
       for (unsigned idx = 0 ; idx < CHUNK_COUNT-1 ; idx += 1)
@@ -54,6 +70,18 @@ slab_t<SLAB_SIZE,CHUNK_COUNT>::slab_t()
 
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
 inline void* slab_t<SLAB_SIZE,CHUNK_COUNT>::alloc_slab()
+{
+      if (! slab_locked)
+	    return alloc_slab_();
+
+      pthread_mutex_lock(&lock_);
+      void*cur = alloc_slab_();
+      pthread_mutex_unlock(&lock_);
+      return cur;
+}
+
+template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
+inline void* slab_t<SLAB_SIZE,CHUNK_COUNT>::alloc_slab_()
 {
       if (heap_ == 0) {
 	    item_cell_u*chunk = new item_cell_u[CHUNK_COUNT];
@@ -71,6 +99,19 @@ inline void* slab_t<SLAB_SIZE,CHUNK_COUNT>::alloc_slab()
 
 template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
 inline void slab_t<SLAB_SIZE,CHUNK_COUNT>::free_slab(void*ptr)
+{
+      if (! slab_locked) {
+	    free_slab_(ptr);
+	    return;
+      }
+
+      pthread_mutex_lock(&lock_);
+      free_slab_(ptr);
+      pthread_mutex_unlock(&lock_);
+}
+
+template <size_t SLAB_SIZE, size_t CHUNK_COUNT>
+inline void slab_t<SLAB_SIZE,CHUNK_COUNT>::free_slab_(void*ptr)
 {
       item_cell_u*cur = reinterpret_cast<item_cell_u*> (ptr);
       cur->next = heap_;
@@ -23,6 +23,10 @@
  * This is a count of the instruction opcodes that were created.
  */
 unsigned long count_opcodes = 0;
+  /* ... and the number of branches shortened by codespace_predecode
+     and of superinstructions created by the compile fuse pass. */
+unsigned long count_opcodes_threaded = 0;
+unsigned long count_opcodes_fused = 0;
 
 unsigned long count_functors = 0;
 unsigned long count_functors_logic = 0;
@@ -31,9 +35,47 @@ unsigned long count_functors_resolv= 0;
 unsigned long count_functors_sig   = 0;
 
 unsigned long count_filters = 0;
+  /* Functor nets with a vvp_net_cache_t, and the sends of unchanged
+     values that those stopped. */
+unsigned long count_cached_nets = 0;
+unsigned long count_propagations_cut = 0;
 unsigned long count_vpi_nets = 0;
 
 unsigned long count_vpi_scopes = 0;
 
+/*
+ * These count the word arrays allocated for wide vvp_vector4_t
+ * values, and the values that the scheduler swapped into events. The
+ * swap only saves a copy if the caller passed a temporary, since a
+ * named value was already copied into the by-value argument.
+ */
+unsigned long count_vector4_allocs = 0;
+unsigned long count_vector4_swaps = 0;
+
+bool count_shared = false;
+
+/*
+ * This counts the pages of array storage that were allocated because
+ * a word in them was written.
+ */
+unsigned long count_array_pages = 0;
+
+/*
+ * Threads and automatic scope contexts are recycled through free
+ * lists in their scope. These count the ones that had to be made,
+ * and the ones that were taken from the free lists.
+ */
+unsigned long count_vthreads = 0;
+unsigned long count_vthreads_reused = 0;
+unsigned long count_contexts = 0;
+unsigned long count_contexts_reused = 0;
+
+/*
+ * CPU time spent reading the input file, and then resolving and
+ * linking what was read. These are only collected in verbose mode.
+ */
+double load_time_parse = 0.0;
+double load_time_link = 0.0;
+
 size_t size_opcodes = 0;
 
@@ -27,12 +27,16 @@
 #endif
 
 extern unsigned long count_opcodes;
+extern unsigned long count_opcodes_threaded;
+extern unsigned long count_opcodes_fused;
 extern unsigned long count_functors;
 extern unsigned long count_functors_logic;
 extern unsigned long count_functors_bufif;
 extern unsigned long count_functors_resolv;
 extern unsigned long count_functors_sig;
 extern unsigned long count_filters;
+extern unsigned long count_cached_nets;
+extern unsigned long count_propagations_cut;
 extern unsigned long count_vvp_nets;
 extern unsigned long count_vpi_nets;
 extern unsigned long count_vpi_scopes;
@@ -48,16 +52,51 @@ extern unsigned long count_real_array_words;
 extern unsigned long count_time_events;
 extern unsigned long count_time_pool(void);
 
+extern unsigned long count_wheel_cascades;
+extern unsigned long count_wheel_peak[];
+extern unsigned schedule_wheel_levels(void);
+extern unsigned schedule_wheel_slots(void);
+
 extern unsigned long count_assign_events;
+extern unsigned long count_coalesced_events;
 extern unsigned long count_assign4_pool(void);
 extern unsigned long count_assign8_pool(void);
 extern unsigned long count_assign_real_pool(void);
 extern unsigned long count_assign_aword_pool(void);
 extern unsigned long count_assign_arword_pool(void);
 
+extern unsigned long count_vector4_allocs;
+extern unsigned long count_vector4_swaps;
+extern unsigned long count_array_pages;
+
+/*
+ * While vvp -j runs net partitions on several threads, count_shared
+ * is set, and the counters that the partitions can change (the ones
+ * above and count_propagations_cut) are counted with an atomic add.
+ */
+extern bool count_shared;
+inline void count_add(unsigned long&cnt)
+{
+      if (count_shared)
+	    __sync_fetch_and_add(&cnt, 1);
+      else
+	    cnt += 1;
+}
+
+extern unsigned long count_vthreads;
+extern unsigned long count_vthreads_reused;
+extern unsigned long count_contexts;
+extern unsigned long count_contexts_reused;
+
 extern unsigned long count_gen_events;
 extern unsigned long count_gen_pool(void);
 
+extern unsigned long count_partition_runs;
+extern unsigned long count_partition_events;
+
+extern double load_time_parse;
+extern double load_time_link;
+
 extern size_t size_opcodes;
 extern size_t size_vvp_nets;
 extern size_t size_vvp_net_funs;
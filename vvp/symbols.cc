@@ -55,318 +55,118 @@ char*symbol_table_s::key_strdup_(const char*str)
 }
 
 /*
- * This is a B-Tree data structure, where there are nodes and
- * leaves.
- *
- * Nodes have a bunch of pointers to children. Each child pointer has
- * associated with it a key that is the largest key referenced by that
- * child. So, if the key being searched for has a value <= the first
- * key of a node, then the value is in the first child.
- *
- * leaves have a sorted table of key-value pairs. The search can use a
- * simple binary search to find an item. Each key represents an item.
+ * The table itself is an open addressed hash table with linear
+ * probing. Each cell holds the full hash of its key, so that probes
+ * only compare strings when the hashes match. The table is kept at
+ * most 3/4 full, and doubles in size when it gets there.
  */
-
-const unsigned leaf_width = 254;
-const unsigned node_width = 508;
-
-struct tree_data_ {
+struct symbol_cell_ {
       char*key;
+      unsigned long hash;
       symbol_value_t val;
 };
 
-struct tree_node_ {
-      bool leaf_flag;
-      unsigned count;
-      struct tree_node_*parent;
+static const unsigned long initial_cells = 256;
 
-      union {
-	    struct tree_data_ leaf[leaf_width];
-	    struct tree_node_ *child[node_width];
-      };
-
-};
-
-static inline char* node_last_key(struct tree_node_*node)
+static inline unsigned long hash_key(const char*key)
 {
-      while (node->leaf_flag == false)
-	    node = node->child[node->count-1];
+	/* This is the FNV-1a string hash. */
+      unsigned long hash = 2166136261UL;
+      for (const unsigned char*cp = (const unsigned char*)key ; *cp ; cp += 1) {
+	    hash ^= *cp;
+	    hash *= 16777619UL;
+      }
+      return hash;
+}
 
-      return node->leaf[node->count-1].key;
+static struct symbol_cell_* new_cells(unsigned long cnt)
+{
+      struct symbol_cell_*cells = new struct symbol_cell_[cnt];
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    cells[idx].key = 0;
+      return cells;
 }
 
-/*
- * Allocate a new symbol table means creating the table structure and
- * a root node, and initializing the pointers and members of the root
- * node.
- */
 symbol_table_s::symbol_table_s()
 {
-      root = new struct tree_node_;
-      root->leaf_flag = false;
-      root->count = 0;
-      root->parent = 0;
+      cells_ = new_cells(initial_cells);
+      mask_  = initial_cells - 1;
+      count_ = 0;
 
       str_chunk = new key_strings;
       str_chunk->next = 0;
       str_used = 0;
 }
 
-static void delete_symbol_node(struct tree_node_*cur)
-{
-      if (! cur->leaf_flag) {
-	    for (unsigned idx = 0 ;  idx < cur->count ;  idx += 1)
-		  delete_symbol_node(cur->child[idx]);
-      }
-
-      delete cur;
-}
-
-/* Do as split_leaf_ does, but for nodes. */
-static void split_node_(struct tree_node_*cur)
-{
-	unsigned int idx, idx1, idx2, tmp;
-	struct tree_node_ *new_node;
-
-	assert(!cur->leaf_flag);
-	if (cur->parent)  assert(! cur->parent->leaf_flag);
-
-	while (cur->count == node_width)
-	{
-		/* Create a new node to hold half the data from cur. */
-		new_node = new struct tree_node_;
-		new_node->leaf_flag = false;
-		new_node->count = cur->count / 2;
-		if (cur->parent)
-			/* cur is not root; new_node becomes sibling. */
-			new_node->parent = cur->parent;
-
-		/* Move the last half of the data from the end of the old node
-		   to the beginning of the new node. At the same time, reduce
-		   the size of the old node. */
-		idx1 = new_node->count;
-		idx2 = cur->count;
-		while (idx1 > 0) {
-		      idx1 -= 1;
-		      idx2 -= 1;
-		      new_node->child[idx1] = cur->child[idx2];
-		      new_node->child[idx1]->parent = new_node;
-		      cur->count -= 1;
-		}
-
-		assert(new_node->count > 0);
-		assert(cur->count > 0);
-
-		if (cur->parent == 0) {
-			/* cur is root. Move first half of children to
-			   another new node, and put the two new nodes
-			   in cur. The plan here is to make cur into
-			   the new root and split its contents into 2
-			   children. */
-
-		      new_node->parent = cur;
-		      struct tree_node_*new2_node = new struct tree_node_;
-		      new2_node->leaf_flag = false;
-		      new2_node->count = cur->count;
-		      new2_node->parent = cur;
-		      for (idx = 0; idx < cur->count; idx += 1) {
-			    new2_node->child[idx] = cur->child[idx];
-			    new2_node->child[idx]->parent = new2_node;
-		      }
-		      cur->child[0] = new2_node;
-		      cur->child[1] = new_node;
-		      cur->count = 2;
-			/* no more ancestors, stop the while loop */
-		      break;
-		}
-
-		/* cur is not root. hook new_node to cur->parent. */
-		idx = 0;
-		while (cur->parent->child[idx] != cur) {
-			assert(idx < cur->parent->count);
-			idx += 1;
-		}
-
-		idx += 1;
-
-		for (tmp = cur->parent->count ;  tmp > idx ;  tmp -= 1)
-			cur->parent->child[tmp] = cur->parent->child[tmp-1];
-
-		cur->parent->child[idx] = new_node;
-		cur->parent->count += 1;
-
-		/* check the ancestor */
-		cur = cur->parent;
-	}
-}
-
 /*
- * This function takes a leaf node and splits in into two. Move half
- * the leaf keys into the new node, and add the new leaf into the
- * parent node.
+ * Resize the table to the given number of cells, which must be a
+ * power of 2, and re-insert all the existing items. The keys
+ * themselves do not move.
  */
-static struct tree_node_* split_leaf_(struct tree_node_*cur)
+void symbol_table_s::rehash_(unsigned long cnt)
 {
-      assert(cur->leaf_flag);
-      assert(cur->parent);
-      assert(! cur->parent->leaf_flag);
-
-	/* Create a new leaf to hold half the data from the old leaf. */
-      struct tree_node_*new_leaf = new struct tree_node_;
-      new_leaf->leaf_flag = true;
-      new_leaf->count = cur->count / 2;
-      new_leaf->parent = cur->parent;
-
-	/* Move the last half of the data from the end of the old leaf
-	   to the beginning of the new leaf. At the same time, reduce
-	   the size of the old leaf. */
-      unsigned idx1 = new_leaf->count;
-      unsigned idx2 = cur->count;
-      while (idx1 > 0) {
-	    idx1 -= 1;
-	    idx2 -= 1;
-	    new_leaf->leaf[idx1] = cur->leaf[idx2];
-	    cur->count -= 1;
-      }
-
-      assert(new_leaf->count > 0);
-      assert(cur->count > 0);
-
-      unsigned idx = 0;
-      while (cur->parent->child[idx] != cur) {
-	    assert(idx < cur->parent->count);
-	    idx += 1;
+      struct symbol_cell_*old_cells = cells_;
+      unsigned long old_cnt = mask_ + 1;
+
+      cells_ = new_cells(cnt);
+      mask_  = cnt - 1;
+
+      for (unsigned long idx = 0 ;  idx < old_cnt ;  idx += 1) {
+	    if (old_cells[idx].key == 0)
+		  continue;
+	    unsigned long pos = old_cells[idx].hash & mask_;
+	    while (cells_[pos].key)
+		  pos = (pos + 1) & mask_;
+	    cells_[pos] = old_cells[idx];
       }
 
-      idx += 1;
-
-      for (unsigned tmp = cur->parent->count ;  tmp > idx ;  tmp -= 1)
-	    cur->parent->child[tmp] = cur->parent->child[tmp-1];
-
-      cur->parent->child[idx] = new_leaf;
-      cur->parent->count += 1;
-
-      if (cur->parent->count == node_width)
-	    split_node_(cur->parent);
-
-      return new_leaf;
+      delete[]old_cells;
 }
 
+void symbol_table_s::sym_reserve(unsigned long count)
+{
+      unsigned long cnt = mask_ + 1;
+      while (count >= cnt/4*3)
+	    cnt *= 2;
+      if (cnt != mask_ + 1)
+	    rehash_(cnt);
+}
 
 /*
- * This function searches tree recursively for the key. If the value
- * is not found (and we are at a leaf) then set the key with the given
- * value. If the key is found, set the value only if the force_flag is
- * true.
+ * This function searches the table for the key. If the value is not
+ * found, then add the key with the given value. If the key is found,
+ * set the value only if the force_flag is true.
  */
-
-symbol_value_t symbol_table_s::find_value_(struct tree_node_*cur,
-					   const char*key, symbol_value_t val,
+symbol_value_t symbol_table_s::find_value_(const char*key, symbol_value_t val,
 					   bool force_flag)
 {
-      if (cur->leaf_flag) {
-
-	    unsigned idx = 0;
-	    for (;;) {
-		    /* If we run out of keys in the leaf, then add
-		       this at the end of the leaf. */
-		  if (idx == cur->count) {
-			cur->leaf[idx].key = key_strdup_(key);
-			cur->leaf[idx].val = val;
-			cur->count += 1;
-			if (cur->count == leaf_width)
-			      split_leaf_(cur);
-
-			return val;
-		  }
-
-		  int rc = strcmp(key, cur->leaf[idx].key);
-
-		    /* If we found the key already in the table, then
-		       set the new value and break. */
-		  if (rc == 0) {
-			if (force_flag)
-			      cur->leaf[idx].val = val;
-			return cur->leaf[idx].val;
-		  }
-
-		    /* If this key goes before the current key, then
-		       push all the following entries back and add
-		       this key here. */
-		  if (rc < 0) {
-			for (unsigned tmp = cur->count; tmp > idx; tmp -= 1)
-			      cur->leaf[tmp] = cur->leaf[tmp-1];
-
-			cur->leaf[idx].key = key_strdup_(key);
-			cur->leaf[idx].val = val;
-			cur->count += 1;
-			if (cur->count == leaf_width)
-			      split_leaf_(cur);
-
-			return val;
-		  }
-
-		  idx += 1;
+      unsigned long hash = hash_key(key);
+      unsigned long pos = hash & mask_;
+
+      while (cells_[pos].key) {
+	    struct symbol_cell_*cur = cells_ + pos;
+	    if (cur->hash == hash && strcmp(cur->key, key) == 0) {
+		  if (force_flag)
+			cur->val = val;
+		  return cur->val;
 	    }
+	    pos = (pos + 1) & mask_;
+      }
 
-      } else {
-	      /* Do a binary search within the inner node. */
-	    unsigned min = 0;
-	    unsigned max = cur->count;
-	    unsigned idx = max/2;
-	    for (;;) {
-		  int rc = strcmp(key, node_last_key(cur->child[idx]));
-		  if (rc == 0) {
-			return find_value_(cur->child[idx],
-					   key, val, force_flag);
-		  }
-
-		  if (rc > 0) {
-			min = idx + 1;
-			if (min == cur->count)
-			      return find_value_(cur->child[idx],
-						 key, val, force_flag);
-			if (min == max)
-			      return find_value_(cur->child[max],
-						 key, val, force_flag);
-
-			idx = min + (max-min)/2;
+      cells_[pos].key  = key_strdup_(key);
+      cells_[pos].hash = hash;
+      cells_[pos].val  = val;
+      count_ += 1;
 
-		  } else  {
-			max = idx;
-			if (idx == min)
-			      return find_value_(cur->child[idx],
-						 key, val, force_flag);
-			idx = min + (max-min)/2;
-		  }
-	    }
-      }
+      if (count_ >= (mask_+1)/4*3)
+	    rehash_(2 * (mask_+1));
 
-      assert(0);
-      { symbol_value_t tmp;
-        tmp.num = 0;
-        return tmp;
-      }
+      return val;
 }
 
 void symbol_table_s::sym_set_value(const char*key, symbol_value_t val)
 {
-      if (root->count == 0) {
-	      /* Handle the special case that this is the very first
-		 value in the symbol table. Create the first leaf node
-		 and initialize the pointers. */
-	    struct tree_node_*cur = new struct tree_node_;
-	    cur->leaf_flag = true;
-	    cur->parent = root;
-	    cur->count = 1;
-	    cur->leaf[0].key = key_strdup_(key);
-	    cur->leaf[0].val = val;
-
-	    root->count = 1;
-	    root->child[0] = cur;
-      } else {
-	    find_value_(root, key, val, true);
-      }
+      find_value_(key, val, true);
 }
 
 symbol_value_t symbol_table_s::sym_get_value(const char*key)
@@ -374,28 +174,29 @@ symbol_value_t symbol_table_s::sym_get_value(const char*key)
       symbol_value_t def;
       def.num = 0;
 
-      if (root->count == 0) {
-	      /* Handle the special case that this is the very first
-		 value in the symbol table. Create the first leaf node
-		 and initialize the pointers. */
-	    struct tree_node_*cur = new struct tree_node_;
-	    cur->leaf_flag = true;
-	    cur->parent = root;
-	    cur->count = 1;
-	    cur->leaf[0].key = key_strdup_(key);
-	    cur->leaf[0].val = def;
+      return find_value_(key, def, false);
+}
 
-	    root->count = 1;
-	    root->child[0] = cur;
-	    return cur->leaf[0].val;
-      } else {
-	    return find_value_(root, key, def, false);
+symbol_value_t symbol_table_s::sym_find_value(const char*key) const
+{
+      unsigned long hash = hash_key(key);
+      unsigned long pos = hash & mask_;
+
+      while (cells_[pos].key) {
+	    const struct symbol_cell_*cur = cells_ + pos;
+	    if (cur->hash == hash && strcmp(cur->key, key) == 0)
+		  return cur->val;
+	    pos = (pos + 1) & mask_;
       }
+
+      symbol_value_t def;
+      def.num = 0;
+      return def;
 }
 
 symbol_table_s::~symbol_table_s()
 {
-      delete_symbol_node(root);
+      delete[]cells_;
       while (str_chunk) {
 	    key_strings*tmp = str_chunk;
 	    str_chunk = tmp->next;
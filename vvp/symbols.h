@@ -68,14 +68,26 @@ class symbol_table_s {
 	// zero and return the zero value.
       symbol_value_t sym_get_value(const char*key);
 
+	// This method locates the value in the symbol table and returns
+	// it. If the value does not exist, return the zero value, but
+	// do not add the key to the table.
+      symbol_value_t sym_find_value(const char*key) const;
+
+	// Make room for at least count symbols, so that a table that
+	// is known to be large does not have to grow step by step.
+      void sym_reserve(unsigned long count);
+
     private:
-      struct tree_node_*root;
+      struct symbol_cell_*cells_;
+      unsigned long mask_;
+      unsigned long count_;
+
       struct key_strings*str_chunk;
       unsigned str_used;
 
-      symbol_value_t find_value_(struct tree_node_*cur,
-				 const char*key, symbol_value_t val,
+      symbol_value_t find_value_(const char*key, symbol_value_t val,
 				 bool force_flag);
+      void rehash_(unsigned long cnt);
       char*key_strdup_(const char*str);
 };
 
@@ -112,6 +124,11 @@ template <class T> class symbol_map_s : private symbol_table_s {
       { symbol_value_t val = symbol_table_s::sym_get_value(key);
 	return reinterpret_cast<T*>(val.ptr);
       }
+
+      T* sym_find_value(const char*key) const
+      { symbol_value_t val = symbol_table_s::sym_find_value(key);
+	return reinterpret_cast<T*>(val.ptr);
+      }
 };
 
 #endif
@@ -81,8 +81,18 @@ ostream& operator <<(ostream&o, const struct udp_levels_table&table)
       return o;
 }
 
+const unsigned long udp_pow3[] = {
+      1UL, 3UL, 9UL, 27UL, 81UL, 243UL, 729UL, 2187UL, 6561UL, 19683UL,
+      59049UL, 177147UL
+};
+
+  /* The largest lookup table compile_lookup_ will build. This allows
+     combinational devices up to 10 inputs and sequential devices up
+     to 7 inputs. */
+static const unsigned long udp_lookup_max = 128*1024;
+
 vvp_udp_s::vvp_udp_s(char*label, unsigned ports, vvp_bit4_t init, bool type)
-: ports_(ports), init_(init), seq_(type)
+: ports_(ports), init_(init), seq_(type), lookup_(0)
 {
       if (!udp_table)
 	    udp_table = new_symbol_table();
@@ -103,6 +113,93 @@ vvp_udp_s::vvp_udp_s(char*label, unsigned ports, vvp_bit4_t init, bool type)
 
 vvp_udp_s::~vvp_udp_s()
 {
+      delete[] lookup_;
+}
+
+static void udp_state_to_levels(udp_levels_table&cur, unsigned long state,
+				unsigned ports)
+{
+      cur.mask0 = 0;
+      cur.mask1 = 0;
+      cur.maskx = 0;
+      for (unsigned pp = 0 ;  pp < ports ;  pp += 1) {
+	    unsigned long mask_bit = 1UL << pp;
+	    switch (state % 3) {
+		case 0:
+		  cur.mask0 |= mask_bit;
+		  break;
+		case 1:
+		  cur.mask1 |= mask_bit;
+		  break;
+		default:
+		  cur.maskx |= mask_bit;
+		  break;
+	    }
+	    state /= 3;
+      }
+}
+
+/*
+ * Fill the lookup table by running calculate_output on every state
+ * that lookup() can be asked for. This is called after compile_table
+ * has compiled the rows, so the table is by construction the same as
+ * the row scan.
+ */
+void vvp_udp_s::compile_lookup_()
+{
+      unsigned digits = ports_ + (seq_? 1 : 0);
+      if (digits >= sizeof udp_pow3 / sizeof udp_pow3[0])
+	    return;
+
+      unsigned long nstates = udp_pow3[digits];
+      unsigned long size = seq_? nstates * ports_ * 2 : nstates;
+      if (size > udp_lookup_max)
+	    return;
+
+      lookup_ = new unsigned char[size];
+
+      if (! seq_) {
+	    for (unsigned long idx = 0 ;  idx < nstates ;  idx += 1) {
+		  udp_levels_table cur;
+		  udp_state_to_levels(cur, idx, ports_);
+		  lookup_[idx] = calculate_output(cur, cur, BIT4_X);
+	    }
+	    return;
+      }
+
+      static const vvp_bit4_t out_bits[3] = { BIT4_0, BIT4_1, BIT4_X };
+      for (unsigned long idx = 0 ;  idx < nstates ;  idx += 1) {
+	    udp_levels_table cur;
+	    udp_state_to_levels(cur, idx, ports_);
+	    vvp_bit4_t cur_out = out_bits[idx / udp_pow3[ports_]];
+
+	    for (unsigned pp = 0 ;  pp < ports_ ;  pp += 1) {
+		  unsigned long mask_bit = 1UL << pp;
+		  unsigned new_digit = (idx / udp_pow3[pp]) % 3;
+
+		  for (unsigned edge = 0 ;  edge < 2 ;  edge += 1) {
+			unsigned old_digit = (new_digit + 1 + edge) % 3;
+			udp_levels_table prev = cur;
+			prev.mask0 &= ~mask_bit;
+			prev.mask1 &= ~mask_bit;
+			prev.maskx &= ~mask_bit;
+			switch (old_digit) {
+			    case 0:
+			      prev.mask0 |= mask_bit;
+			      break;
+			    case 1:
+			      prev.mask1 |= mask_bit;
+			      break;
+			    default:
+			      prev.maskx |= mask_bit;
+			      break;
+			}
+
+			lookup_[(idx*ports_ + pp)*2 + edge] =
+			      calculate_output(cur, prev, cur_out);
+		  }
+	    }
+      }
 }
 
 unsigned vvp_udp_s::port_count() const
@@ -292,6 +389,8 @@ void vvp_udp_comb_s::compile_table(char**tab)
 
       assert(nrows0 == nlevels0_);
       assert(nrows1 == nlevels1_);
+
+      compile_lookup_();
 }
 
 vvp_udp_seq_s::vvp_udp_seq_s(char*label, char*name,
@@ -672,6 +771,7 @@ void vvp_udp_seq_s::compile_table(char**tab)
       assert(idx_edg1 == nedges1_);
       assert(idx_edgL == nedgesL_);
 
+      compile_lookup_();
 }
 
 bool operator == (const udp_levels_table&a, const udp_levels_table&b)
@@ -908,6 +1008,8 @@ vvp_udp_fun_core::vvp_udp_fun_core(vvp_net_t*net, vvp_udp_s*def)
       current_.mask0 = 0;
       current_.mask1 = 0;
       current_.maskx = ~ ((-1UL) << port_count());
+	// ... which is all 2 digits in the lookup state.
+      state_ = def_->has_lookup()? udp_pow3[port_count()] - 1 : 0;
 
       if (cur_out_ != BIT4_X)
 	    schedule_functor(this);
@@ -935,6 +1037,8 @@ void vvp_udp_fun_core::recv_vec4_from_inputs(unsigned port)
       unsigned long mask = 1UL << port;
 
       udp_levels_table prev = current_;
+      unsigned old_digit = (prev.mask0 & mask)? 0 : (prev.mask1 & mask)? 1 : 2;
+      unsigned new_digit;
 
       switch (value(port).value(0)) {
 
@@ -942,20 +1046,30 @@ void vvp_udp_fun_core::recv_vec4_from_inputs(unsigned port)
 	    current_.mask0 |= mask;
 	    current_.mask1 &= ~mask;
 	    current_.maskx &= ~mask;
+	    new_digit = 0;
 	    break;
 	  case BIT4_1:
 	    current_.mask0 &= ~mask;
 	    current_.mask1 |= mask;
 	    current_.maskx &= ~mask;
+	    new_digit = 1;
 	    break;
 	  default:
 	    current_.mask0 &= ~mask;
 	    current_.mask1 &= ~mask;
 	    current_.maskx |= mask;
+	    new_digit = 2;
 	    break;
       }
 
-      vvp_bit4_t out_bit = def_->calculate_output(current_, prev, cur_out_);
+      vvp_bit4_t out_bit;
+      if (def_->has_lookup()) {
+	    state_ += new_digit * udp_pow3[port];
+	    state_ -= old_digit * udp_pow3[port];
+	    out_bit = def_->lookup(state_, port, old_digit, new_digit, cur_out_);
+      } else {
+	    out_bit = def_->calculate_output(current_, prev, cur_out_);
+      }
 
       if (out_bit == cur_out_)
 	    return;
@@ -28,6 +28,14 @@
 
 struct udp_levels_table;
 
+/*
+ * The state of the inputs of a UDP instance is also kept as a number
+ * with one base 3 digit per input: 0, 1 or 2 for x/z. The LSD is the
+ * first input. This is the index into the lookup table of the
+ * definition, if it has one.
+ */
+extern const unsigned long udp_pow3[];
+
 struct vvp_udp_s {
 
     public:
@@ -48,12 +56,50 @@ struct vvp_udp_s {
 					  const udp_levels_table&prev,
 					  vvp_bit4_t cur_out) =0;
 
+	// If the device is narrow enough, compile_table also fills a
+	// lookup table with the result of calculate_output for every
+	// input state (and for sequential devices every current
+	// output and edge), so that an evaluation is one load instead
+	// of a scan of the rows. Wider devices keep the scan.
+      bool has_lookup() const { return lookup_ != 0; }
+
+	// The input state is after the input on port changed from
+	// old_digit to new_digit. Only call this if has_lookup().
+      vvp_bit4_t lookup(unsigned long state, unsigned port,
+			unsigned old_digit, unsigned new_digit,
+			vvp_bit4_t cur_out) const;
+
+    protected:
+      void compile_lookup_();
+
     private:
       unsigned ports_;
       vvp_bit4_t init_;
       bool seq_;
+
+      unsigned char*lookup_;
 };
 
+inline vvp_bit4_t vvp_udp_s::lookup(unsigned long state, unsigned port,
+				    unsigned old_digit, unsigned new_digit,
+				    vvp_bit4_t cur_out) const
+{
+      if (! seq_)
+	    return (vvp_bit4_t) lookup_[state];
+
+	/* A change between x and z is no change at all. */
+      if (old_digit == new_digit)
+	    return cur_out;
+
+	/* The current output is the most significant digit of the
+	   state, and each input has two possible edges into its
+	   current value. */
+      unsigned out_digit = cur_out == BIT4_0? 0 : cur_out == BIT4_1? 1 : 2;
+      state += out_digit * udp_pow3[ports_];
+      unsigned edge = (old_digit == (new_digit+1) % 3)? 0 : 1;
+      return (vvp_bit4_t) lookup_[(state*ports_ + port)*2 + edge];
+}
+
 /*
  * The vvp_udp_async_s instance represents a *definition* of a
  * primitive. netlist instances refer to these definitions.
@@ -240,6 +286,7 @@ class vvp_udp_fun_core  : public vvp_wide_fun_core, private vvp_gen_event_s {
       vvp_udp_s*def_;
       vvp_bit4_t cur_out_;
       udp_levels_table current_;
+      unsigned long state_;
 };
 
 #endif
@@ -216,6 +216,8 @@ void sync_cb::run_run()
 	   null, then just skip the whole thing and free it. This is
 	   the usual way to cancel one-time callbacks of this sort. */
       if (cur->cb_data.cb_rtn != 0) {
+	    profile_enter_t prof (profile_active?
+				  profile_callback(cur->cb_data.reason) : 0);
 	    assert(vpi_mode_flag == VPI_MODE_NONE);
 	    vpi_mode_flag = sync_flag? VPI_MODE_ROSYNC : VPI_MODE_RWSYNC;
 	    (cur->cb_data.cb_rtn)(&cur->cb_data);
@@ -395,6 +397,8 @@ void vpiNextSimTime(void)
       while (NextSimTime) {
 	    cur = NextSimTime;
 	    NextSimTime = cur->next;
+	    profile_enter_t prof (profile_active?
+				  profile_callback(cbNextSimTime) : 0);
 	    (cur->cb_data.cb_rtn)(&cur->cb_data);
 	    delete_vpi_callback(cur);
       }
@@ -514,6 +518,8 @@ void callback_execute(struct __vpiCallback*cur)
 	    assert(0);
 	    break;
       }
+      profile_enter_t prof (profile_active?
+			    profile_callback(cur->cb_data.reason) : 0);
       (cur->cb_data.cb_rtn)(&cur->cb_data);
 
       vpi_mode_flag = save_mode;
@@ -543,6 +549,8 @@ void vvp_vpi_callback::add_vpi_callback(__vpiCallback*cb)
 {
       cb->next = vpi_callbacks_;
       vpi_callbacks_ = cb;
+	/* The net this is attached to is no longer local. */
+      vvp_net_t::partitions_stale = true;
 }
 
 #ifdef CHECK_WITH_VALGRIND
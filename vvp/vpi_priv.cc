@@ -26,6 +26,7 @@
 # include  <cassert>
 # include  <cstdlib>
 # include  <cmath>
+# include  <string>
 
 vpi_mode_t vpi_mode_flag = VPI_MODE_NONE;
 FILE*vpi_trace = 0;
@@ -1050,71 +1051,123 @@ vpiHandle vpi_handle_by_index(vpiHandle ref, PLI_INT32 idx)
       return (ref->vpi_type->index_)(ref, idx);
 }
 
+static bool handle_is_scope(vpiHandle obj)
+{
+      switch (obj->vpi_type->type_code) {
+	  case vpiModule:
+	  case vpiFunction:
+	  case vpiTask:
+	  case vpiNamedBegin:
+	  case vpiNamedFork:
+	    return true;
+	  default:
+	    return false;
+      }
+}
+
+static bool handle_is_array(vpiHandle obj)
+{
+      return obj->vpi_type->type_code == vpiMemory
+	  || obj->vpi_type->type_code == vpiNetArray;
+}
+
+/*
+ * Return true if a comes before b in the list of items of the scope
+ * (or the list of root scopes if scope is 0). This only matters when
+ * two different items could match a name, which is rare.
+ */
+static bool comes_first(struct __vpiScope*scope, vpiHandle a, vpiHandle b)
+{
+      vpiHandle*table;
+      unsigned ntable;
+      if (scope) {
+	    table = scope->intern;
+	    ntable = scope->nintern;
+      } else {
+	    vpip_make_root_iterator(table, ntable);
+      }
+
+      for (unsigned idx = 0 ;  idx < ntable ;  idx += 1) {
+	    if (table[idx] == a) return true;
+	    if (table[idx] == b) return false;
+      }
+      return false;
+}
+
+/*
+ * Find the object called name directly in the scope handle. This is
+ * the first item of the scope with that name, or a word of the first
+ * memory whose words include that name, whichever comes first in the
+ * scope. Memory words are not in the name index, so for a name like
+ * "mem[3]" look up the array "mem" and get the word by its index.
+ */
 static vpiHandle find_name(const char *name, vpiHandle handle)
 {
-      vpiHandle rtn = 0;
       struct __vpiScope*ref = (struct __vpiScope*)handle;
+      vpiHandle rtn = vpip_find_in_scope(ref, name);
+
+      const char*bp = strrchr(name, '[');
+      if (bp && bp != name && name[strlen(name)-1] == ']') {
+	    std::string base (name, bp - name);
+	    vpiHandle arr = vpip_find_in_scope(ref, base.c_str(),
+					       handle_is_array);
+	    char*ep;
+	    long idx = strtol(bp+1, &ep, 10);
+	    if (arr && ep != bp+1 && *ep == ']') {
+		  vpiHandle word = vpi_handle_by_index(arr, idx);
+		  const char*nm = word ? vpi_get_str(vpiName, word) : 0;
+		  if (nm && !strcmp(name, nm)
+		      && (rtn == 0 || comes_first(ref, arr, rtn)))
+			rtn = word;
+	    }
+      }
 
       /* check module names */
-      if (!strcmp(name, vpi_get_str(vpiName, handle)))
+      if (rtn == 0 && !strcmp(name, vpi_get_str(vpiName, handle)))
 	    rtn = handle;
 
-      /* brute force search for the name in all objects in this scope */
-      for (unsigned i = 0 ;  i < ref->nintern ;  i += 1) {
-	    char *nm = vpi_get_str(vpiName, ref->intern[i]);
-	    if (!strcmp(name, nm)) {
-		  rtn = ref->intern[i];
-		  break;
-	    } else if (vpi_get(vpiType, ref->intern[i]) == vpiMemory ||
-	               vpi_get(vpiType, ref->intern[i]) == vpiNetArray) {
-		  /* We need to iterate on the words */
-		  vpiHandle word_i, word_h;
-		  word_i = vpi_iterate(vpiMemoryWord, ref->intern[i]);
-		  while (word_i && (word_h = vpi_scan(word_i))) {
-			nm = vpi_get_str(vpiName, word_h);
-			if (!strcmp(name, nm)) {
-			      rtn = word_h;
-			      break;
-			}
-		  }
-	    }
-	    /* found it yet? */
-	    if (rtn) break;
-      }
-
       return rtn;
 }
 
-static vpiHandle find_scope(const char *name, vpiHandle handle, int depth)
+/*
+ * Find the deepest scope that the hierarchical name starts with. The
+ * first part of the name (or the whole name) must be a root module,
+ * and each following part that is followed by a '.' may be a child
+ * scope of the scope before it. Escaped names may contain a '.', so
+ * at each level try every '.' and take the child that comes first in
+ * the scope, as a search of the list would.
+ */
+static vpiHandle find_scope(const char *name)
 {
-      vpiHandle iter, hand, rtn = 0;
-
-      iter = !handle ? vpi_iterate(vpiModule, NULL) :
-		       vpi_iterate(vpiInternalScope, handle);
-
-      while (iter && (hand = vpi_scan(iter))) {
-	    char *nm = vpi_get_str(vpiName, hand);
-	    int len = strlen(nm);
-	    const char *cp = name + len;	/* hier separator */
-
-	    if (!handle && !strcmp(name, nm)) {
-		  /* root module */
-		  rtn = hand;
-	    } else if (!strncmp(name, nm, len) && *(cp) == '.')
-		  /* recurse deeper */
-		  rtn = find_scope(cp+1, hand, depth + 1);
-
-	    /* found it yet ? */
-	    if (rtn) {
-		  vpi_free_object(iter);
-		  break;
+      struct __vpiScope*scope = 0;
+      const char*rest = name;
+      std::string key;
+
+      for (;;) {
+	    vpiHandle best = 0;
+	    const char*best_cp = 0;
+
+	    for (const char*cp = rest ;  ;  cp += 1) {
+		  if (*cp == '.' || (*cp == 0 && scope == 0)) {
+			key.assign(rest, cp - rest);
+			vpiHandle hand = vpip_find_in_scope(scope, key.c_str(),
+							    handle_is_scope);
+			if (hand && (best == 0 || comes_first(scope, hand, best))) {
+			      best = hand;
+			      best_cp = cp;
+			}
+		  }
+		  if (*cp == 0) break;
 	    }
-      }
 
-      /* matched up to here */
-      if (!rtn) rtn = handle;
+	    if (best == 0)
+		  return scope ? &scope->base : 0;
+	    if (*best_cp == 0)
+		  return best;
 
-      return rtn;
+	    scope = (struct __vpiScope*)best;
+	    rest = best_cp + 1;
+      }
 }
 
 vpiHandle vpi_handle_by_name(const char *name, vpiHandle scope)
@@ -1144,7 +1197,7 @@ vpiHandle vpi_handle_by_name(const char *name, vpiHandle scope)
 	          return 0;
 	    }
       } else {
-	    hand = find_scope(name, NULL, 0);
+	    hand = find_scope(name);
       }
 
       if (hand) {
@@ -1154,9 +1207,7 @@ vpiHandle vpi_handle_by_name(const char *name, vpiHandle scope)
 	    const char *cp = name + len;
 	    if (!strncmp(name, nm, len) && *cp == '.') name = cp + 1;
 
-	    /* Ok, time to burn some cycles */
-	    vpiHandle out = find_name(name, hand);
-	    return out;
+	    return find_name(name, hand);
       }
 
       return 0;
@@ -207,6 +207,13 @@ struct __vpiScope {
       vvp_context_t free_contexts;
 	/* Keep a list of threads in the scope. */
       std::set<vthread_t> threads;
+	/* Keep a list of finished threads, for reuse by new threads
+	   of this scope, and the most thread bits any thread of the
+	   scope has used. */
+      vthread_t free_threads;
+      unsigned thread_bits;
+	/* Two of the intern items have the same name. */
+      bool dup_names;
       signed int time_units :8;
       signed int time_precision :8;
 };
@@ -214,6 +221,14 @@ struct __vpiScope {
 extern struct __vpiScope* vpip_peek_current_scope(void);
 extern void vpip_attach_to_scope(struct __vpiScope*scope, vpiHandle obj);
 extern void vpip_attach_to_current_scope(vpiHandle obj);
+/*
+ * Find the first item called name attached to the scope (or the first
+ * root scope called name if scope is 0) that the test, if any,
+ * accepts. This is the item that a search of the list in order would
+ * find, but it is looked up in a hash index.
+ */
+extern vpiHandle vpip_find_in_scope(struct __vpiScope*scope, const char*name,
+				    bool (*test)(vpiHandle) = 0);
 extern struct __vpiScope* vpip_peek_context_scope(void);
 extern unsigned vpip_add_item_to_context(automatic_hooks_s*item,
                                          struct __vpiScope*scope);
@@ -25,6 +25,7 @@
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
+# include  <cstdio>
 # include  <cstring>
 # include  <cstdlib>
 # include  <cassert>
@@ -32,6 +33,33 @@
 static vpiHandle *vpip_root_table_ptr = 0;
 static unsigned   vpip_root_table_cnt = 0;
 
+/*
+ * The name index maps a (scope, name) pair to the first item of that
+ * name attached to the scope, or with a null scope to the first root
+ * scope of that name. The key is the scope pointer and the local name,
+ * so a lookup only ever matches a direct child of the scope. The index
+ * is built the first time vpip_find_in_scope is called, and after that
+ * the new scopes and items are added as they are attached. A scope
+ * that has more than one item of the same name is marked, and lookups
+ * in it search its list instead.
+ *
+ * The index is an open addressed hash table with linear probing, like
+ * the symbol tables. Each cell holds the hash of its scope and name,
+ * and the name is kept with vpip_name_string, so neither adding an
+ * item nor looking one up builds a key string.
+ */
+struct name_index_cell_s {
+      const struct __vpiScope*scope;
+      const char*name;
+      unsigned long hash;
+      vpiHandle obj;
+};
+
+static struct name_index_cell_s*name_index = 0;
+static unsigned long name_index_mask = 0;
+static unsigned long name_index_count = 0;
+static bool root_dup_names = false;
+
 vpiHandle vpip_make_root_iterator(void)
 {
       assert(vpip_root_table_ptr);
@@ -106,6 +134,11 @@ void root_table_delete(void)
       free(vpip_root_table_ptr);
       vpip_root_table_ptr = 0;
       vpip_root_table_cnt = 0;
+      delete[]name_index;
+      name_index = 0;
+      name_index_mask = 0;
+      name_index_count = 0;
+      root_dup_names = false;
 }
 #endif
 
@@ -371,6 +404,133 @@ static const struct __vpirt vpip_scope_fork_rt = {
  */
 static struct __vpiScope*current_scope = 0;
 
+static unsigned long name_index_hash(const struct __vpiScope*scope,
+				     const char*name)
+{
+	/* This is the FNV-1a hash of the name, started from the
+	   scope pointer. */
+      unsigned long hash = 2166136261UL ^ (unsigned long)(size_t)scope;
+      for (const unsigned char*cp = (const unsigned char*)name ; *cp ; cp += 1) {
+	    hash ^= *cp;
+	    hash *= 16777619UL;
+      }
+      return hash;
+}
+
+/*
+ * Return the cell that holds the (scope, name) key, or the empty cell
+ * where it would go.
+ */
+static struct name_index_cell_s* name_index_cell(const struct __vpiScope*scope,
+						 const char*name,
+						 unsigned long hash)
+{
+      unsigned long pos = hash & name_index_mask;
+      for (;;) {
+	    struct name_index_cell_s*cell = name_index + pos;
+	    if (cell->name == 0)
+		  return cell;
+	    if (cell->hash == hash && cell->scope == scope
+		&& strcmp(cell->name, name) == 0)
+		  return cell;
+	    pos = (pos + 1) & name_index_mask;
+      }
+}
+
+static void name_index_resize(unsigned long cnt)
+{
+      struct name_index_cell_s*old_cells = name_index;
+      unsigned long old_cnt = old_cells? name_index_mask + 1 : 0;
+
+      name_index = new struct name_index_cell_s[cnt];
+      name_index_mask = cnt - 1;
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1) {
+	    name_index[idx].name = 0;
+	    name_index[idx].obj = 0;
+      }
+
+      for (unsigned long idx = 0 ;  idx < old_cnt ;  idx += 1) {
+	    if (old_cells[idx].name == 0)
+		  continue;
+	    unsigned long pos = old_cells[idx].hash & name_index_mask;
+	    while (name_index[pos].name)
+		  pos = (pos + 1) & name_index_mask;
+	    name_index[pos] = old_cells[idx];
+      }
+
+      delete[]old_cells;
+}
+
+static void name_index_add(struct __vpiScope*scope, vpiHandle obj)
+{
+      const char*name = vpi_get_str(vpiName, obj);
+      if (name == 0)
+	    return;
+
+      unsigned long hash = name_index_hash(scope, name);
+      struct name_index_cell_s*cell = name_index_cell(scope, name, hash);
+      if (cell->name) {
+	    if (scope)
+		  scope->dup_names = true;
+	    else
+		  root_dup_names = true;
+	    return;
+      }
+
+	/* Keep the table at most 3/4 full. */
+      if (name_index_count+1 > (name_index_mask+1)/4*3) {
+	    name_index_resize(2 * (name_index_mask+1));
+	    cell = name_index_cell(scope, name, hash);
+      }
+
+      cell->scope = scope;
+      cell->name = vpip_name_string(name);
+      cell->hash = hash;
+      cell->obj = obj;
+      name_index_count += 1;
+}
+
+static void name_index_add_scope(struct __vpiScope*scope)
+{
+      for (unsigned idx = 0 ;  idx < scope->nintern ;  idx += 1) {
+	    vpiHandle obj = scope->intern[idx];
+	    name_index_add(scope, obj);
+	    if (handle_is_scope(obj))
+		  name_index_add_scope((struct __vpiScope*)obj);
+      }
+}
+
+vpiHandle vpip_find_in_scope(struct __vpiScope*scope, const char*name,
+			     bool (*test)(vpiHandle))
+{
+      if (name_index == 0) {
+	    name_index_resize(1024);
+	    for (unsigned idx = 0 ;  idx < vpip_root_table_cnt ;  idx += 1) {
+		  vpiHandle root = vpip_root_table_ptr[idx];
+		  name_index_add(0, root);
+		  name_index_add_scope((struct __vpiScope*)root);
+	    }
+      }
+
+      if (scope ? scope->dup_names : root_dup_names) {
+	    vpiHandle*table = scope ? scope->intern : vpip_root_table_ptr;
+	    unsigned ntable = scope ? scope->nintern : vpip_root_table_cnt;
+	    for (unsigned idx = 0 ;  idx < ntable ;  idx += 1) {
+		  const char*nm = vpi_get_str(vpiName, table[idx]);
+		  if (nm && strcmp(nm, name) == 0
+		      && (test == 0 || test(table[idx])))
+			return table[idx];
+	    }
+	    return 0;
+      }
+
+      vpiHandle obj = name_index_cell(scope, name,
+				      name_index_hash(scope, name))->obj;
+      if (obj && test && !test(obj))
+	    return 0;
+      return obj;
+}
+
 void vpip_attach_to_scope(struct __vpiScope*scope, vpiHandle obj)
 {
       assert(scope);
@@ -384,6 +544,9 @@ void vpip_attach_to_scope(struct __vpiScope*scope, vpiHandle obj)
 		  realloc(scope->intern, sizeof(vpiHandle)*scope->nintern);
 
       scope->intern[idx] = obj;
+
+      if (name_index)
+	    name_index_add(scope, obj);
 }
 
 /*
@@ -444,6 +607,9 @@ compile_scope_decl(char*label, char*type, char*name, char*tname,
       scope->nitem = 0;
       scope->live_contexts = 0;
       scope->free_contexts = 0;
+      scope->free_threads = 0;
+      scope->thread_bits = 0;
+      scope->dup_names = false;
 
       current_scope = scope;
 
@@ -474,6 +640,8 @@ compile_scope_decl(char*label, char*type, char*name, char*tname,
 		  realloc(vpip_root_table_ptr, cnt * sizeof(vpiHandle));
 	    vpip_root_table_ptr[vpip_root_table_cnt] = &scope->base;
 	    vpip_root_table_cnt = cnt;
+	    if (name_index)
+		  name_index_add(0, &scope->base);
 
 	      /* Root scopes inherit time_units and precision from the
 	         system precision. */
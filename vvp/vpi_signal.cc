@@ -729,6 +729,31 @@ static void signal_get_value(vpiHandle ref, s_vpi_value*vp)
       }
 }
 
+/*
+ * This is the vpip_get_planes extension. Waveform dumpers use it in
+ * place of vpiBinStrVal to get a changed value. The value is copied
+ * into a buffer that is kept from call to call, so a value of the
+ * same width as the last is copied without allocating.
+ */
+PLI_INT32 vpip_get_planes(vpiHandle ref, p_vpip_planes planes)
+{
+      struct __vpiSignal*rfp = vpip_signal_from_handle(ref);
+      if (rfp == 0)
+	    return 0;
+
+      vvp_signal_value*vsig = dynamic_cast<vvp_signal_value*>(rfp->node->fil);
+      if (vsig == 0)
+	    return 0;
+
+      static vvp_vector4_t buf;
+      vsig->vec4_value(buf);
+
+      planes->size  = buf.size();
+      planes->abits = buf.abits_words();
+      planes->bbits = buf.bbits_words();
+      return 1;
+}
+
 /*
  * The put_value method writes the value into the vector, and returns
  * the affected ref. This operation works much like the %set or
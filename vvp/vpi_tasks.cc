@@ -830,6 +830,9 @@ void vpip_execute_vpi_call(vthread_t thr, vpiHandle ref)
       vpip_cur_task = (struct __vpiSysTaskCall*)ref;
 
       if (vpip_cur_task->defn->info.calltf) {
+	    profile_enter_t prof (profile_active?
+				  profile_vpi_call(vpip_cur_task->scope,
+					 vpip_cur_task->defn->info.tfname) : 0);
 	    assert(vpi_mode_flag == VPI_MODE_NONE);
 	    vpi_mode_flag = VPI_MODE_CALLTF;
 	    vpip_cur_task->put_value = false;
@@ -25,6 +25,8 @@
 # include  "event.h"
 # include  "vpi_priv.h"
 # include  "vvp_net_sig.h"
+# include  "profile.h"
+# include  "statistics.h"
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
@@ -337,11 +339,13 @@ static vvp_context_t vthread_alloc_context(struct __vpiScope*scope)
             for (unsigned idx = 0 ; idx < scope->nitem ; idx += 1) {
                   scope->item[idx]->reset_instance(context);
             }
+            count_contexts_reused += 1;
       } else {
             context = vvp_allocate_context(scope->nitem);
             for (unsigned idx = 0 ; idx < scope->nitem ; idx += 1) {
                   scope->item[idx]->alloc_instance(context);
             }
+            count_contexts += 1;
       }
 
       vvp_set_next_context(context, scope->live_contexts);
@@ -393,13 +397,26 @@ void contexts_delete(struct __vpiScope*scope)
 #endif
 
 /*
- * Create a new thread with the given start address.
+ * Create a new thread with the given start address. By preference,
+ * reuse a thread that has finished in the same scope. It keeps the
+ * bits that it had grown to, so the new thread will usually not need
+ * to grow them at all. A thread that must be made is given as many
+ * bits as any thread of the scope has used.
  */
 vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
 {
-      vthread_t thr = new struct vthread_s;
+      vthread_t thr = scope->free_threads;
+      if (thr) {
+	    scope->free_threads = thr->wait_next;
+	    thr->bits4.set_to_x();
+	    count_vthreads_reused += 1;
+      } else {
+	    thr = new struct vthread_s;
+	    unsigned wid = scope->thread_bits;
+	    thr->bits4 = vvp_vector4_t(wid > 32? wid : 32);
+	    count_vthreads += 1;
+      }
       thr->pc     = pc;
-      thr->bits4  = vvp_vector4_t(32);
       thr->child  = 0;
       thr->parent = 0;
       thr->parent_scope = scope;
@@ -460,6 +477,11 @@ void vthreads_delete(struct __vpiScope*scope)
 	    delete *cur;
       }
       scope->threads.clear();
+
+      while (vthread_t thr = scope->free_threads) {
+	    scope->free_threads = thr->wait_next;
+	    delete thr;
+      }
 }
 #endif
 
@@ -499,10 +521,19 @@ static void vthread_reap(vthread_t thr)
       }
 }
 
+/*
+ * A dead thread goes on the free list of its scope for reuse by
+ * vthread_new. It is safe to use the wait_next to link them because
+ * a thread is never deleted while it is waiting.
+ */
 void vthread_delete(vthread_t thr)
 {
-      thr->bits4 = vvp_vector4_t();
-      delete thr;
+      struct __vpiScope*scope = thr->parent_scope;
+      if (thr->bits4.size() > scope->thread_bits)
+	    scope->thread_bits = thr->bits4.size();
+
+      thr->wait_next = scope->free_threads;
+      scope->free_threads = thr;
 }
 
 void vthread_mark_scheduled(vthread_t thr)
@@ -520,6 +551,27 @@ void vthread_delay_delete()
 	    running_thread->delay_delete = 1;
 }
 
+/*
+ * This is the inner loop of vthread_run when the profiler is on. It
+ * charges each instruction to the scope of the thread.
+ */
+static void vthread_run_profiled_(vthread_t thr)
+{
+      profile_bucket_s*save = profile_current;
+
+      for (;;) {
+	    vvp_code_t cp = thr->pc;
+	    thr->pc += 1;
+
+	    profile_current = profile_opcode(thr->parent_scope, cp->opcode);
+	    bool rc = (cp->opcode)(thr, cp);
+	    if (rc == false)
+		  break;
+      }
+
+      profile_current = save;
+}
+
 /*
  * This function runs each thread by fetching an instruction,
  * incrementing the PC, and executing the instruction. The thread may
@@ -536,6 +588,12 @@ void vthread_run(vthread_t thr)
 
             running_thread = thr;
 
+	    if (profile_active) {
+		  vthread_run_profiled_(thr);
+		  thr = tmp;
+		  continue;
+	    }
+
 	    for (;;) {
 		  vvp_code_t cp = thr->pc;
 		  thr->pc += 1;
@@ -877,9 +935,8 @@ bool of_ASSIGN_AV(vthread_t thr, vvp_code_t cp)
 
       assert(wid > 0);
 
-      vvp_vector4_t value = vthread_bits_to_vector(thr, bit, wid);
-
-      schedule_assign_array_word(cp->array, adr, off, value, delay);
+      schedule_assign_array_word(cp->array, adr, off,
+				 vthread_bits_to_vector(thr, bit, wid), delay);
       return true;
 }
 
@@ -916,9 +973,8 @@ bool of_ASSIGN_AVD(vthread_t thr, vvp_code_t cp)
 
       assert(wid > 0);
 
-      vvp_vector4_t value = vthread_bits_to_vector(thr, bit, wid);
-
-      schedule_assign_array_word(cp->array, adr, off, value, delay);
+      schedule_assign_array_word(cp->array, adr, off,
+				 vthread_bits_to_vector(thr, bit, wid), delay);
       return true;
 }
 
@@ -1062,10 +1118,9 @@ bool of_ASSIGN_V0X1(vthread_t thr, vvp_code_t cp)
 
       assert(wid > 0);
 
-      vvp_vector4_t value = vthread_bits_to_vector(thr, bit, wid);
-
       vvp_net_ptr_t ptr (cp->net, 0);
-      schedule_assign_vector(ptr, off, sig->value_size(), value, delay);
+      schedule_assign_vector(ptr, off, sig->value_size(),
+			     vthread_bits_to_vector(thr, bit, wid), delay);
 
       return true;
 }
@@ -1098,10 +1153,9 @@ bool of_ASSIGN_V0X1D(vthread_t thr, vvp_code_t cp)
 
       assert(wid > 0);
 
-      vvp_vector4_t value = vthread_bits_to_vector(thr, bit, wid);
-
       vvp_net_ptr_t ptr (cp->net, 0);
-      schedule_assign_vector(ptr, off, sig->value_size(), value, delay);
+      schedule_assign_vector(ptr, off, sig->value_size(),
+			     vthread_bits_to_vector(thr, bit, wid), delay);
 
       return true;
 }
@@ -2571,7 +2625,7 @@ bool of_INV(vthread_t thr, vvp_code_t cp)
 {
       assert(cp->bit_idx[0] >= 4);
 
-      if (cp->number <= 4)
+      if (cp->bit_idx[1] <= 4)
 	    cp->opcode = &of_INV_narrow;
       else
 	    cp->opcode = &of_INV_wide;
@@ -2823,6 +2877,71 @@ bool of_JMP1(vthread_t thr, vvp_code_t cp)
       return true;
 }
 
+/*
+ * The compare/branch superinstructions run the compare, then do the
+ * work of the conditional branch that follows it in the code space,
+ * saving a trip through the dispatch loop. The branch flavor is taken
+ * from the branch instruction itself.
+ */
+static inline bool fused_branch(vthread_t thr, vvp_code_t cp)
+{
+      vvp_code_t jp = cp + 1;
+      vvp_bit4_t val = thr_get_bit(thr, jp->bit_idx[0]);
+
+      bool take;
+      if (jp->opcode == &of_JMP0XZ)
+	    take = val != BIT4_1;
+      else if (jp->opcode == &of_JMP0)
+	    take = val == BIT4_0;
+      else
+	    take = val == BIT4_1;
+
+      thr->pc = take? jp->cptr : jp + 1;
+
+      if (schedule_stopped()) {
+	    schedule_vthread(thr, 0, false);
+	    return false;
+      }
+
+      return true;
+}
+
+bool of_CMPIS_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPIS(thr, cp);
+      return fused_branch(thr, cp);
+}
+
+bool of_CMPIU_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPIU(thr, cp);
+      return fused_branch(thr, cp);
+}
+
+bool of_CMPS_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPS(thr, cp);
+      return fused_branch(thr, cp);
+}
+
+bool of_CMPU_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPU(thr, cp);
+      return fused_branch(thr, cp);
+}
+
+bool of_CMPX_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPX(thr, cp);
+      return fused_branch(thr, cp);
+}
+
+bool of_CMPZ_JMP(vthread_t thr, vvp_code_t cp)
+{
+      of_CMPZ(thr, cp);
+      return fused_branch(thr, cp);
+}
+
 /*
  * The %join instruction causes the thread to wait for the one and
  * only child to die.  If it is already dead (and a zombie) then I
@@ -4602,3 +4721,25 @@ bool of_EXEC_UFUNC(vthread_t thr, vvp_code_t cp)
 
       return true;
 }
+
+/*
+ * Some opcodes replace themselves with a specialized implementation
+ * the first time they run. Map those back to the opcode that the
+ * compiler created, so that the profile report can name them.
+ */
+vvp_code_fun vthread_generic_opcode(vvp_code_fun opcode)
+{
+      if (opcode == &of_AND_narrow || opcode == &of_AND_wide)
+	    return &of_AND;
+      if (opcode == &of_INV_narrow || opcode == &of_INV_wide)
+	    return &of_INV;
+      if (opcode == &of_MOV_ || opcode == &of_MOV1XZ_)
+	    return &of_MOV;
+      if (opcode == &of_NAND_narrow || opcode == &of_NAND_wide)
+	    return &of_NAND;
+      if (opcode == &of_OR_narrow || opcode == &of_OR_wide)
+	    return &of_OR;
+      if (opcode == &of_NOR_narrow || opcode == &of_NOR_wide)
+	    return &of_NOR;
+      return opcode;
+}
@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2026 agent (agent@local)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/*
+ * vvp_bench times the basic run time operations of vvp, one case at a
+ * time and at several widths, and prints the time each operation
+ * takes. It is linked with the vvp objects (but not main.o) and is
+ * built and run by "make bench". It is not installed.
+ *
+ * The vector cases only use vvp_vector4_t methods that older versions
+ * of vvp also have, so this file can be built against an older tree
+ * to see what a change to those methods gains. The arith cases drive
+ * each .arith and .cmp functor. At widths that fit in an unsigned
+ * long they also time the *_narrow class that compile.cc picks there.
+ *
+ *    vvp_bench [<prefix>]
+ *
+ * With a prefix, only the cases whose name starts with it are run.
+ */
+
+# include  "config.h"
+# include  "compile.h"
+# include  "vpi_priv.h"
+# include  "vvp_net.h"
+# include  "arith.h"
+# include  <cstdio>
+# include  <cstring>
+# include  <sys/time.h>
+
+/*
+ * These are the parts of main.cc that the rest of the run time
+ * refers to.
+ */
+ofstream debug_file;
+bool verbose_flag = false;
+int vpip_delay_selection = _vpiDelaySelTypical;
+void vpip_set_return_value(int) { }
+void verify_version(char*, char*) { }
+void set_delay_selection(const char*) { }
+
+static const unsigned widths[] = { 8, 32, 64, 128, 256, 512, 0 };
+
+/* The cases store results here so that they are not optimized away. */
+static volatile unsigned long bench_sink = 0;
+
+static double time_now(void)
+{
+      struct timeval tv;
+      gettimeofday(&tv, 0);
+      return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/*
+ * Make a vector with a mix of 0 and 1 bits and no X or Z, which is
+ * what the fast paths are for.
+ */
+static vvp_vector4_t make_vec(unsigned wid, unsigned seed)
+{
+      vvp_vector4_t res (wid, BIT4_0);
+      for (unsigned idx = 0 ;  idx < wid ;  idx += 1) {
+	    seed = seed * 1103515245 + 12345;
+	    res.set_bit(idx, (seed >> 16) & 1 ? BIT4_1 : BIT4_0);
+      }
+      return res;
+}
+
+typedef void (*bench_fun_t)(unsigned wid, unsigned long cnt);
+
+/*
+ * Run a case with more and more iterations until it takes long enough
+ * to time, then print the time per iteration.
+ */
+static void run_case(const char*prefix, const char*name, unsigned wid,
+		     bench_fun_t fun)
+{
+      if (prefix && strncmp(name, prefix, strlen(prefix)) != 0)
+	    return;
+
+      unsigned long cnt = 1000;
+      double elapsed;
+      for (;;) {
+	    double start = time_now();
+	    fun(wid, cnt);
+	    elapsed = time_now() - start;
+	    if (elapsed >= 0.2 || cnt >= 1000000000UL)
+		  break;
+	    cnt *= 4;
+      }
+
+      printf("%-24s %4u bits %10.1f ns\n", name, wid, elapsed * 1e9 / cnt);
+      fflush(stdout);
+}
+
+static void run_widths(const char*prefix, const char*name, bench_fun_t fun)
+{
+      for (unsigned idx = 0 ;  widths[idx] ;  idx += 1)
+	    run_case(prefix, name, widths[idx], fun);
+}
+
+/*
+ * The vvp_vector4_t cases.
+ */
+
+static void bench_vec4_copy(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t src = make_vec(wid, 1);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1) {
+	    vvp_vector4_t tmp (src);
+	    bench_sink += tmp.size();
+      }
+}
+
+static void bench_vec4_assign(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t src1 = make_vec(wid, 1);
+      vvp_vector4_t src2 = make_vec(wid, 2);
+      vvp_vector4_t dst (wid);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 2) {
+	    dst = src1;
+	    dst = src2;
+      }
+      bench_sink += dst.size();
+}
+
+static void bench_vec4_eeq(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t a = make_vec(wid, 1);
+      vvp_vector4_t b = make_vec(wid, 1);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    bench_sink += a.eeq(b);
+}
+
+static void bench_vec4_has_xz(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t a = make_vec(wid, 1);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    bench_sink += a.has_xz();
+}
+
+static void bench_vec4_mov(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t a = make_vec(wid, 1);
+      unsigned half = wid / 2;
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    a.mov(0, half + 3, half - 3);
+      bench_sink += a.size();
+}
+
+static void bench_vec4_and_or(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t a = make_vec(wid, 1);
+      vvp_vector4_t b = make_vec(wid, 2);
+      vvp_vector4_t c = make_vec(wid, 3);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 2) {
+	    a &= b;
+	    a |= c;
+      }
+      bench_sink += a.size();
+}
+
+static void bench_vec4_invert(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t a = make_vec(wid, 1);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    a.invert();
+      bench_sink += a.size();
+}
+
+static void bench_vec4_copy_bits(unsigned wid, unsigned long cnt)
+{
+      vvp_vector4_t src = make_vec(wid, 1);
+      vvp_vector4_t dst (wid);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 1)
+	    dst.copy_bits(src);
+      bench_sink += dst.size();
+}
+
+/*
+ * This functor keeps a copy of each value it receives, which is what
+ * a signal does, so a send to it costs a vector assignment.
+ */
+class bench_store_fun : public vvp_net_fun_t {
+
+    public:
+      void recv_vec4(vvp_net_ptr_t, const vvp_vector4_t&bit, vvp_context_t)
+      { value_ = bit; }
+
+    private:
+      vvp_vector4_t value_;
+};
+
+/* Send a value from one net to four nets that keep a copy of it. */
+static void bench_vec4_send(unsigned wid, unsigned long cnt)
+{
+      vvp_net_t*src = new vvp_net_t;
+      for (unsigned idx = 0 ;  idx < 4 ;  idx += 1) {
+	    vvp_net_t*dst = new vvp_net_t;
+	    dst->fun = new bench_store_fun;
+	    src->link(vvp_net_ptr_t(dst, 0));
+      }
+
+      vvp_vector4_t val1 = make_vec(wid, 1);
+      vvp_vector4_t val2 = make_vec(wid, 2);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 2) {
+	    src->send_vec4(val1, 0);
+	    src->send_vec4(val2, 0);
+      }
+}
+
+/*
+ * The arith cases make a functor and send new values to its A input
+ * while the B input holds still, which is what a functor sees when
+ * one operand changes. The output is not linked, so this times only
+ * the functor.
+ */
+typedef vvp_net_fun_t* (*arith_make_t)(unsigned wid);
+
+static arith_make_t bench_arith_make = 0;
+
+static void bench_arith(unsigned wid, unsigned long cnt)
+{
+      vvp_net_t*net = new vvp_net_t;
+      net->fun = bench_arith_make(wid);
+
+      vvp_vector4_t val1 = make_vec(wid, 1);
+      vvp_vector4_t val2 = make_vec(wid, 2);
+      vvp_vector4_t valb = make_vec(wid, 3);
+      net->fun->recv_vec4(vvp_net_ptr_t(net, 1), valb, 0);
+
+      vvp_net_ptr_t port_a (net, 0);
+      for (unsigned long idx = 0 ;  idx < cnt ;  idx += 2) {
+	    net->fun->recv_vec4(port_a, val1, 0);
+	    net->fun->recv_vec4(port_a, val2, 0);
+      }
+}
+
+/*
+ * Run an arith case at each width. The narrow classes are only made
+ * for widths that fit in an unsigned long.
+ */
+static void run_arith(const char*prefix, const char*name,
+		      arith_make_t make, bool narrow)
+{
+      bench_arith_make = make;
+      for (unsigned idx = 0 ;  widths[idx] ;  idx += 1) {
+	    if (narrow && widths[idx] > 8 * sizeof(unsigned long))
+		  break;
+	    run_case(prefix, name, widths[idx], bench_arith);
+      }
+}
+
+static vvp_net_fun_t* make_sum(unsigned wid)
+{ return new vvp_arith_sum(wid); }
+static vvp_net_fun_t* make_sum_narrow(unsigned wid)
+{ return new vvp_arith_sum_narrow(wid); }
+static vvp_net_fun_t* make_sub(unsigned wid)
+{ return new vvp_arith_sub(wid); }
+static vvp_net_fun_t* make_sub_narrow(unsigned wid)
+{ return new vvp_arith_sub_narrow(wid); }
+static vvp_net_fun_t* make_mult(unsigned wid)
+{ return new vvp_arith_mult(wid); }
+static vvp_net_fun_t* make_mult_narrow(unsigned wid)
+{ return new vvp_arith_mult_narrow(wid); }
+static vvp_net_fun_t* make_ge(unsigned wid)
+{ return new vvp_cmp_ge(wid, false); }
+static vvp_net_fun_t* make_ge_narrow(unsigned wid)
+{ return new vvp_cmp_ge_narrow(wid, false); }
+static vvp_net_fun_t* make_ge_s(unsigned wid)
+{ return new vvp_cmp_ge(wid, true); }
+static vvp_net_fun_t* make_ge_s_narrow(unsigned wid)
+{ return new vvp_cmp_ge_narrow(wid, true); }
+static vvp_net_fun_t* make_gt(unsigned wid)
+{ return new vvp_cmp_gt(wid, false); }
+static vvp_net_fun_t* make_gt_narrow(unsigned wid)
+{ return new vvp_cmp_gt_narrow(wid, false); }
+static vvp_net_fun_t* make_eq(unsigned wid)
+{ return new vvp_cmp_eq(wid); }
+static vvp_net_fun_t* make_ne(unsigned wid)
+{ return new vvp_cmp_ne(wid); }
+static vvp_net_fun_t* make_eeq(unsigned wid)
+{ return new vvp_cmp_eeq(wid); }
+static vvp_net_fun_t* make_nee(unsigned wid)
+{ return new vvp_cmp_nee(wid); }
+
+int main(int argc, char*argv[])
+{
+      const char*prefix = argc > 1 ? argv[1] : 0;
+
+      run_widths(prefix, "vec4/copy",      bench_vec4_copy);
+      run_widths(prefix, "vec4/assign",    bench_vec4_assign);
+      run_widths(prefix, "vec4/eeq",       bench_vec4_eeq);
+      run_widths(prefix, "vec4/has_xz",    bench_vec4_has_xz);
+      run_widths(prefix, "vec4/mov",       bench_vec4_mov);
+      run_widths(prefix, "vec4/and_or",    bench_vec4_and_or);
+      run_widths(prefix, "vec4/invert",    bench_vec4_invert);
+      run_widths(prefix, "vec4/copy_bits", bench_vec4_copy_bits);
+      run_widths(prefix, "vec4/send",      bench_vec4_send);
+
+      run_arith(prefix, "arith/sum",         make_sum,         false);
+      run_arith(prefix, "arith/sum_narrow",  make_sum_narrow,  true);
+      run_arith(prefix, "arith/sub",         make_sub,         false);
+      run_arith(prefix, "arith/sub_narrow",  make_sub_narrow,  true);
+      run_arith(prefix, "arith/mult",        make_mult,        false);
+      run_arith(prefix, "arith/mult_narrow", make_mult_narrow, true);
+      run_arith(prefix, "cmp/ge",            make_ge,          false);
+      run_arith(prefix, "cmp/ge_narrow",     make_ge_narrow,   true);
+      run_arith(prefix, "cmp/ge_s",          make_ge_s,        false);
+      run_arith(prefix, "cmp/ge_s_narrow",   make_ge_s_narrow, true);
+      run_arith(prefix, "cmp/gt",            make_gt,          false);
+      run_arith(prefix, "cmp/gt_narrow",     make_gt_narrow,   true);
+      run_arith(prefix, "cmp/eq",            make_eq,          false);
+      run_arith(prefix, "cmp/ne",            make_ne,          false);
+      run_arith(prefix, "cmp/eeq",           make_eeq,         false);
+      run_arith(prefix, "cmp/nee",           make_nee,         false);
+
+      return 0;
+}
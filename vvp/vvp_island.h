@@ -25,6 +25,7 @@
 # include  "symbols.h"
 # include  "schedule.h"
 # include  <list>
+# include  <vector>
 # include  <cassert>
 
 /*
@@ -56,6 +57,7 @@
 
 class vvp_island_branch;
 class vvp_island_node;
+class vvp_island_port;
 
 class vvp_island  : private vvp_gen_event_s {
 
@@ -66,8 +68,10 @@ class vvp_island  : private vvp_gen_event_s {
 	// Ports call this method to flag that something happened at
 	// the input. The island will use this to create an active
 	// event. The run_run() method will then be called by the
-	// scheduler to process whatever happened.
-      void flag_island();
+	// scheduler to process whatever happened. The island also
+	// remembers which ports were flagged, so that it can limit
+	// its work to the parts of the mesh they touch.
+      void flag_island(vvp_island_port*port);
 
 	// This is the method that is called, eventually, to process
 	// whatever happened. The derived island class implements this
@@ -80,6 +84,11 @@ class vvp_island  : private vvp_gen_event_s {
 	// scanning the mesh.
       vvp_island_branch*branches_;
 
+	// The ports that have been flagged since the last run. The
+	// derived class clears the flag of each port as it takes it
+	// off this list.
+      std::vector<vvp_island_port*> flagged_ports_;
+
     public: /* These methods are used during linking. */
 
 	// Add a port to the island. The key is added to the island
@@ -140,6 +149,13 @@ class vvp_island_port  : public vvp_net_fun_t {
       vvp_vector8_t invalue;
       vvp_vector8_t outvalue;
 
+	// The island keeps these. The flagged member is true while
+	// the port is on the flagged_ports_ list of the island, and
+	// the components are the parts of the island mesh that
+	// depend on this port.
+      bool flagged;
+      std::vector<unsigned> components;
+
     private:
       vvp_island*island_;
 
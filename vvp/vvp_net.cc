@@ -22,6 +22,7 @@
 # include  "vpi_priv.h"
 # include  "schedule.h"
 # include  "statistics.h"
+# include  "slab.h"
 # include  <cstdio>
 # include  <cstring>
 # include  <cstdlib>
@@ -30,9 +31,11 @@
 # include  <climits>
 # include  <cmath>
 # include  <cassert>
+# include  <map>
+# include  <vector>
+# include  <algorithm>
 #ifdef CHECK_WITH_VALGRIND
 # include  <valgrind/memcheck.h>
-# include  <map>
 # include "sfunc.h"
 #endif
 
@@ -47,6 +50,8 @@ static vvp_net_t **vvp_net_pool = 0;
 static unsigned vvp_net_pool_count = 0;
 #endif
 static size_t vvp_net_alloc_remaining = 0;
+// All the chunks, in allocation order, for walking all the nets.
+static vector<vvp_net_t*> vvp_net_chunks;
 // For statistics, count the vvp_nets allocated and the bytes of alloc
 // chunks allocated.
 unsigned long count_vvp_nets = 0;
@@ -59,6 +64,7 @@ void* vvp_net_t::operator new (size_t size)
 	    vvp_net_alloc_table = ::new vvp_net_t[VVP_NET_CHUNK];
 	    vvp_net_alloc_remaining = VVP_NET_CHUNK;
 	    size_vvp_nets += size*VVP_NET_CHUNK;
+	    vvp_net_chunks.push_back(vvp_net_alloc_table);
 #ifdef CHECK_WITH_VALGRIND
 	    VALGRIND_MAKE_MEM_NOACCESS(vvp_net_alloc_table, size*VVP_NET_CHUNK);
 	    VALGRIND_CREATE_MEMPOOL(vvp_net_alloc_table, 0, 0);
@@ -149,6 +155,158 @@ void vvp_net_t::operator delete(void*)
       assert(0);
 }
 
+/*
+ * Split the net graph into regions of nets that are connected to each
+ * other by output-to-input links, ignoring the direction of the
+ * links. Nets in different regions can only interact through threads,
+ * events and the like, so the number and size of the regions shows
+ * how much of the structural evaluation is independent. This is a
+ * plain union-find over the net index within the chunks.
+ */
+static unsigned long partition_root_(unsigned long*parent,
+				     unsigned long idx)
+{
+      while (parent[idx] != idx) {
+	    parent[idx] = parent[parent[idx]];
+	    idx = parent[idx];
+      }
+      return idx;
+}
+
+// The chunks sorted by address, with the index of their first net,
+// for getting from a net pointer to the net index.
+static vector< pair<const vvp_net_t*,unsigned long> > vvp_net_chunk_index;
+
+static void index_chunks_(void)
+{
+      vvp_net_chunk_index.resize(vvp_net_chunks.size());
+      for (unsigned idx = 0 ; idx < vvp_net_chunks.size() ; idx += 1)
+	    vvp_net_chunk_index[idx] = make_pair(vvp_net_chunks[idx],
+						 idx * VVP_NET_CHUNK);
+      sort(vvp_net_chunk_index.begin(), vvp_net_chunk_index.end());
+}
+
+static unsigned long net_index_(const vvp_net_t*net)
+{
+      vector< pair<const vvp_net_t*,unsigned long> >::const_iterator cur
+	    = upper_bound(vvp_net_chunk_index.begin(), vvp_net_chunk_index.end(),
+			  make_pair(net, ULONG_MAX));
+      if (cur == vvp_net_chunk_index.begin())
+	    return ULONG_MAX;
+      --cur;
+      if (net >= cur->first + VVP_NET_CHUNK)
+	    return ULONG_MAX;
+      unsigned long idx = cur->second + (net - cur->first);
+      return idx < count_vvp_nets? idx : ULONG_MAX;
+}
+
+/*
+ * Afterwards the partition_root_ of a net index is the same for all
+ * the nets of a partition.
+ */
+void vvp_net_t::partition_nets_(unsigned long*parent)
+{
+      index_chunks_();
+
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1)
+	    parent[idx] = idx;
+
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1) {
+	    vvp_net_t*net = vvp_net_chunks[idx/VVP_NET_CHUNK] + idx%VVP_NET_CHUNK;
+	    unsigned long root = partition_root_(parent, idx);
+
+	    for (vvp_net_ptr_t cur = net->out_ ; cur.ptr() ; ) {
+		  vvp_net_t*dst = cur.ptr();
+		  unsigned long dst_idx = net_index_(dst);
+		  assert(dst_idx != ULONG_MAX);
+		  unsigned long dst_root = partition_root_(parent, dst_idx);
+		  if (dst_root != root) {
+			parent[dst_root] = root;
+		  }
+		  cur = dst->port[cur.port()];
+	    }
+      }
+}
+
+void vvp_net_t::count_partitions(unsigned long&count, unsigned long&largest)
+{
+      count = 0;
+      largest = 0;
+      if (count_vvp_nets == 0)
+	    return;
+
+      vector<unsigned long> parent (count_vvp_nets);
+      partition_nets_(&parent[0]);
+
+      map<unsigned long,unsigned long> sizes;
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1)
+	    sizes[partition_root_(&parent[0], idx)] += 1;
+
+      count = sizes.size();
+      for (map<unsigned long,unsigned long>::iterator cur = sizes.begin()
+		 ; cur != sizes.end() ; ++ cur) {
+	    if (cur->second > largest)
+		  largest = cur->second;
+      }
+}
+
+bool vvp_net_t::partitions_stale = true;
+
+// The local partition number of each net, by net index.
+static vector<unsigned long> vvp_net_local_partition;
+
+static bool net_is_local_(const vvp_net_t*net)
+{
+      if (net->fun && ! net->fun->local_only())
+	    return false;
+      if (net->fil && net->fil->has_vpi_callbacks())
+	    return false;
+      return true;
+}
+
+unsigned long vvp_net_t::number_partitions(void)
+{
+      partitions_stale = false;
+      vvp_net_local_partition.clear();
+      if (count_vvp_nets == 0)
+	    return 0;
+
+      vector<unsigned long> parent (count_vvp_nets);
+      partition_nets_(&parent[0]);
+
+	/* A root stays marked local until a net of its partition
+	   is found that is not. */
+      vector<bool> local (count_vvp_nets, true);
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1) {
+	    vvp_net_t*net = vvp_net_chunks[idx/VVP_NET_CHUNK] + idx%VVP_NET_CHUNK;
+	    if (! net_is_local_(net))
+		  local[partition_root_(&parent[0], idx)] = false;
+      }
+
+	/* Number the local roots, then give every net the number
+	   of its root. */
+      unsigned long count = 0;
+      vvp_net_local_partition.assign(count_vvp_nets, 0);
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1) {
+	    if (parent[idx] == idx && local[idx])
+		  vvp_net_local_partition[idx] = ++count;
+      }
+      for (unsigned long idx = 0 ; idx < count_vvp_nets ; idx += 1)
+	    vvp_net_local_partition[idx]
+		  = vvp_net_local_partition[partition_root_(&parent[0], idx)];
+
+      return count;
+}
+
+unsigned long vvp_net_t::local_partition(void) const
+{
+      assert(! partitions_stale);
+      unsigned long idx = net_index_(this);
+      if (idx == ULONG_MAX)
+	    return 0;
+      return vvp_net_local_partition[idx];
+}
+
 vvp_net_t::vvp_net_t()
 {
       out_ = vvp_net_ptr_t(0,0);
@@ -158,6 +316,7 @@ vvp_net_t::vvp_net_t()
 
 void vvp_net_t::link(vvp_net_ptr_t port_to_link)
 {
+      partitions_stale = true;
       vvp_net_t*net = port_to_link.ptr();
       net->port[port_to_link.port()] = out_;
       out_ = port_to_link;
@@ -171,6 +330,7 @@ void vvp_net_t::link(vvp_net_ptr_t port_to_link)
  */
 void vvp_net_t::unlink(vvp_net_ptr_t dst_ptr)
 {
+      partitions_stale = true;
       vvp_net_t*net = dst_ptr.ptr();
       unsigned net_port = dst_ptr.port();
 
@@ -315,6 +475,85 @@ void vvp_net_fil_t::force_unlink(void)
       force_link_->port[2] = vvp_net_ptr_t(0,0);
 }
 
+vvp_net_cache_t::vvp_net_cache_t()
+: valid_(false)
+{
+}
+
+vvp_net_cache_t::~vvp_net_cache_t()
+{
+}
+
+vvp_net_fil_t::prop_t vvp_net_cache_t::filter_vec4(const vvp_vector4_t&bit,
+						   vvp_vector4_t&,
+						   unsigned base,
+						   unsigned vwid)
+{
+      if (base != 0 || bit.size() != vwid) {
+	    valid_ = false;
+	    return PROP;
+      }
+
+      if (valid_ && val_.eeq(bit)) {
+	    count_add(count_propagations_cut);
+	    return STOP;
+      }
+
+      val_ = bit;
+      valid_ = true;
+      return PROP;
+}
+
+vvp_net_fil_t::prop_t vvp_net_cache_t::filter_vec8(const vvp_vector8_t&,
+						   vvp_vector8_t&,
+						   unsigned, unsigned)
+{
+      valid_ = false;
+      return PROP;
+}
+
+void vvp_net_cache_t::release(vvp_net_ptr_t, bool)
+{
+      assert(0);
+}
+
+void vvp_net_cache_t::release_pv(vvp_net_ptr_t, unsigned, unsigned, bool)
+{
+      assert(0);
+}
+
+unsigned vvp_net_cache_t::filter_size() const
+{
+      return val_.size();
+}
+
+void vvp_net_cache_t::force_fil_vec4(const vvp_vector4_t&, vvp_vector2_t)
+{
+      assert(0);
+}
+
+void vvp_net_cache_t::force_fil_vec8(const vvp_vector8_t&, vvp_vector2_t)
+{
+      assert(0);
+}
+
+void vvp_net_cache_t::force_fil_real(double, vvp_vector2_t)
+{
+      assert(0);
+}
+
+void vvp_net_cache_t::get_value(struct t_vpi_value*)
+{
+      assert(0);
+}
+
+void vvp_net_t::cache_output()
+{
+      assert(fil == 0);
+      fil = new vvp_net_cache_t;
+      count_cached_nets += 1;
+}
+
 /* *** BIT operations *** */
 vvp_bit4_t add_with_carry(vvp_bit4_t a, vvp_bit4_t b, vvp_bit4_t&c)
 {
@@ -436,8 +675,11 @@ void vvp_send_vec8(vvp_net_ptr_t ptr, const vvp_vector8_t&val)
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_vec8(ptr, val);
+	    }
 
 	    ptr = next;
       }
@@ -448,8 +690,11 @@ void vvp_send_real(vvp_net_ptr_t ptr, double val, vvp_context_t context)
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_real(ptr, val, context);
+	    }
 
 	    ptr = next;
       }
@@ -460,8 +705,11 @@ void vvp_send_long(vvp_net_ptr_t ptr, long val)
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_long(ptr, val);
+	    }
 
 	    ptr = next;
       }
@@ -473,8 +721,11 @@ void vvp_send_long_pv(vvp_net_ptr_t ptr, long val,
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_long_pv(ptr, val, base, wid);
+	    }
 
 	    ptr = next;
       }
@@ -487,11 +738,10 @@ void vvp_vector4_t::copy_bits(const vvp_vector4_t&that)
 
       if (size_ == that.size_) {
 	    if (size_ > BITS_PER_WORD) {
+		    // The abits and bbits are contiguous in a single
+		    // array, so copy them in one pass.
 		  unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
-		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
-			abits_ptr_[idx] = that.abits_ptr_[idx];
-		  for (unsigned idx = 0 ;  idx < words ;  idx += 1)
-			bbits_ptr_[idx] = that.bbits_ptr_[idx];
+		  memcpy(abits_ptr_, that.abits_ptr_, 2*words*sizeof(unsigned long));
 	    } else {
 		  abits_val_ = that.abits_val_;
 		  bbits_val_ = that.bbits_val_;
@@ -564,18 +814,51 @@ void vvp_vector4_t::copy_bits(const vvp_vector4_t&that)
       }
 }
 
+/*
+ * Wide vectors keep their abits and bbits in a single double-length
+ * array. Vectors of a few words are very common (wide busses) and are
+ * copied every time a value propagates, so recycle those arrays
+ * through size class slab heaps. Really wide vectors are rare enough
+ * that the general heap is fine for them.
+ */
+static slab_t<2*2*sizeof(unsigned long),1024> vector4_words2_heap;
+static slab_t<2*4*sizeof(unsigned long),512>  vector4_words4_heap;
+static slab_t<2*8*sizeof(unsigned long),256>  vector4_words8_heap;
+
+unsigned long* vvp_vector4_t::alloc_words_(unsigned cnt)
+{
+      count_add(count_vector4_allocs);
+      if (cnt <= 2)
+	    return static_cast<unsigned long*>(vector4_words2_heap.alloc_slab());
+      if (cnt <= 4)
+	    return static_cast<unsigned long*>(vector4_words4_heap.alloc_slab());
+      if (cnt <= 8)
+	    return static_cast<unsigned long*>(vector4_words8_heap.alloc_slab());
+
+      return new unsigned long[2*cnt];
+}
+
+void vvp_vector4_t::free_words_(unsigned long*ptr, unsigned cnt)
+{
+      if (cnt <= 2)
+	    vector4_words2_heap.free_slab(ptr);
+      else if (cnt <= 4)
+	    vector4_words4_heap.free_slab(ptr);
+      else if (cnt <= 8)
+	    vector4_words8_heap.free_slab(ptr);
+      else
+	    delete[]ptr;
+}
+
 void vvp_vector4_t::copy_from_(const vvp_vector4_t&that)
 {
       size_ = that.size_;
       if (size_ > BITS_PER_WORD) {
 	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
-	    abits_ptr_ = new unsigned long[2*words];
+	    abits_ptr_ = alloc_words_(words);
 	    bbits_ptr_ = abits_ptr_ + words;
 
-	    for (unsigned idx = 0 ;  idx < words ;  idx += 1)
-		  abits_ptr_[idx] = that.abits_ptr_[idx];
-	    for (unsigned idx = 0 ;  idx < words ;  idx += 1)
-		  bbits_ptr_[idx] = that.bbits_ptr_[idx];
+	    memcpy(abits_ptr_, that.abits_ptr_, 2*words*sizeof(unsigned long));
 
       } else {
 	    abits_val_ = that.abits_val_;
@@ -593,7 +876,7 @@ void vvp_vector4_t::copy_inverted_from_(const vvp_vector4_t&that)
       size_ = that.size_;
       if (size_ > BITS_PER_WORD) {
 	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
-	    abits_ptr_ = new unsigned long[2*words];
+	    abits_ptr_ = alloc_words_(words);
 	    bbits_ptr_ = abits_ptr_ + words;
 
 	    unsigned remaining = size_;
@@ -622,7 +905,7 @@ void vvp_vector4_t::allocate_words_(unsigned wid, unsigned long inita, unsigned
 {
       if (size_ > BITS_PER_WORD) {
 	    unsigned cnt = (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
-	    abits_ptr_ = new unsigned long[2*cnt];
+	    abits_ptr_ = alloc_words_(cnt);
 	    bbits_ptr_ = abits_ptr_ + cnt;
 	    for (unsigned idx = 0 ;  idx < cnt ;  idx += 1)
 		  abits_ptr_[idx] = inita;
@@ -825,7 +1108,7 @@ void vvp_vector4_t::resize(unsigned newsize)
 		  return;
 	    }
 
-	    unsigned long*newbits = new unsigned long[2*newcnt];
+	    unsigned long*newbits = alloc_words_(newcnt);
 
 	    if (cnt > 1) {
 		  unsigned trans = cnt;
@@ -837,7 +1120,7 @@ void vvp_vector4_t::resize(unsigned newsize)
 		  for (unsigned idx = 0 ;  idx < trans ;  idx += 1)
 			newbits[newcnt+idx] = bbits_ptr_[idx];
 
-		  delete[]abits_ptr_;
+		  free_words_(abits_ptr_, cnt);
 
 	    } else {
 		  newbits[0] = abits_val_;
@@ -857,7 +1140,7 @@ void vvp_vector4_t::resize(unsigned newsize)
 	    if (cnt > 1) {
 		  unsigned long newvala = abits_ptr_[0];
 		  unsigned long newvalb = bbits_ptr_[0];
-		  delete[]abits_ptr_;
+		  free_words_(abits_ptr_, cnt);
 		  abits_val_ = newvala;
 		  bbits_val_ = newvalb;
 	    }
@@ -1188,8 +1471,29 @@ void vvp_vector4_t::mov(unsigned dst, unsigned src, unsigned cnt)
 	    unsigned dptr = dst / BITS_PER_WORD;
 	    unsigned soff = src % BITS_PER_WORD;
 	    unsigned doff = dst % BITS_PER_WORD;
+	      // Whole destination words can be filled in a single
+	      // step if the source bits are never overwritten before
+	      // they are read. That is true if the bits move down or
+	      // the ranges do not overlap.
+	    bool funnel_ok = dst < src || src+cnt <= dst;
 
 	    while (cnt > 0) {
+		  if (funnel_ok && doff == 0 && soff != 0
+		      && cnt >= BITS_PER_WORD) {
+			  // The destination is aligned and the
+			  // source is not, so merge two source words
+			  // into the destination word.
+			unsigned long noff = BITS_PER_WORD - soff;
+			abits_ptr_[dptr] = (abits_ptr_[sptr] >> soff)
+			      | (abits_ptr_[sptr+1] << noff);
+			bbits_ptr_[dptr] = (bbits_ptr_[sptr] >> soff)
+			      | (bbits_ptr_[sptr+1] << noff);
+			dptr += 1;
+			sptr += 1;
+			cnt -= BITS_PER_WORD;
+			continue;
+		  }
+
 		  unsigned trans = cnt;
 		  if ((soff+trans) > BITS_PER_WORD)
 			trans = BITS_PER_WORD - soff;
@@ -1255,11 +1559,13 @@ bool vvp_vector4_t::eeq(const vvp_vector4_t&that) const
 		  && (bbits_val_ == that.bbits_val_);
       }
 
+	// Test the a and b words together so that there is a single
+	// branch per word in the common (equal) case.
       unsigned words = size_ / BITS_PER_WORD;
       for (unsigned idx = 0 ;  idx < words ;  idx += 1) {
-	    if (abits_ptr_[idx] != that.abits_ptr_[idx])
-		  return false;
-	    if (bbits_ptr_[idx] != that.bbits_ptr_[idx])
+	    unsigned long diff = (abits_ptr_[idx] ^ that.abits_ptr_[idx])
+		  | (bbits_ptr_[idx] ^ that.bbits_ptr_[idx]);
+	    if (diff)
 		  return false;
       }
 
@@ -1318,8 +1624,16 @@ bool vvp_vector4_t::has_xz() const
 	    return bbits_val_;
       }
 
+	// Collect the bbits a few words at a time so that wide
+	// vectors need only one test per group of words.
       unsigned words = size_ / BITS_PER_WORD;
-      for (unsigned idx = 0 ; idx < words ; idx += 1) {
+      unsigned idx = 0;
+      for ( ; idx+4 <= words ; idx += 4) {
+	    if (bbits_ptr_[idx] | bbits_ptr_[idx+1]
+		| bbits_ptr_[idx+2] | bbits_ptr_[idx+3])
+		  return true;
+      }
+      for ( ; idx < words ; idx += 1) {
 	    if (bbits_ptr_[idx])
 		  return true;
       }
@@ -1688,9 +2002,18 @@ bool vector4_to_value(const vvp_vector4_t&vec, double&val, bool signed_flag)
       return flag;
 }
 
+unsigned long array_sparse_words = 1024*1024;
+
 vvp_realarray_t::vvp_realarray_t(unsigned wor)
-: words_(wor)
+: words_(wor), array_(0), pages_(0)
 {
+      if (array_sparse_words && words_ >= array_sparse_words) {
+	    unsigned npages = ((words_-1) >> PAGE_SHIFT) + 1;
+	    pages_ = (double**)calloc(npages, sizeof(double*));
+	    assert(pages_);
+	    return;
+      }
+
       array_ = new double[words_];
 	// Real array words have a default value of zero.
       for (unsigned idx = 0 ; idx < words_; idx += 1) {
@@ -1700,6 +2023,12 @@ vvp_realarray_t::vvp_realarray_t(unsigned wor)
 
 vvp_realarray_t::~vvp_realarray_t()
 {
+      if (pages_) {
+	    unsigned npages = ((words_-1) >> PAGE_SHIFT) + 1;
+	    for (unsigned idx = 0 ; idx < npages ; idx += 1)
+		  delete[]pages_[idx];
+	    free(pages_);
+      }
       delete[]array_;
 }
 
@@ -1707,15 +2036,35 @@ void vvp_realarray_t::set_word(unsigned word, double value)
 {
       if (word >= words_)
 	    return;
-      array_[word] = value;
+
+      if (pages_ == 0) {
+	    array_[word] = value;
+	    return;
+      }
+
+      double*&page = pages_[word >> PAGE_SHIFT];
+      if (page == 0) {
+	    page = new double[1 << PAGE_SHIFT];
+	    for (unsigned idx = 0 ; idx < (1 << PAGE_SHIFT) ; idx += 1)
+		  page[idx] = 0.0;
+	    count_add(count_array_pages);
+      }
+      page[word & ((1 << PAGE_SHIFT) - 1)] = value;
 }
 
 double vvp_realarray_t::get_word(unsigned word) const
 {
       if (word >= words_)
 	    return 0.0;
-      else
+
+      if (pages_ == 0)
 	    return array_[word];
+
+      const double*page = pages_[word >> PAGE_SHIFT];
+      if (page == 0)
+	    return 0.0;
+
+      return page[word & ((1 << PAGE_SHIFT) - 1)];
 }
 
 vvp_vector4array_t::vvp_vector4array_t(unsigned width__, unsigned words__)
@@ -1777,40 +2126,101 @@ vvp_vector4_t vvp_vector4array_t::get_word_(v4cell*cell) const
 vvp_vector4array_sa::vvp_vector4array_sa(unsigned width__, unsigned words__)
 : vvp_vector4array_t(width__, words__)
 {
-      array_ = new v4cell[words_];
+      cnt_ = (width_ + vvp_vector4_t::BITS_PER_WORD-1)/vvp_vector4_t::BITS_PER_WORD;
 
-      if (width_ <= vvp_vector4_t::BITS_PER_WORD) {
-	    for (unsigned idx = 0 ; idx < words_ ; idx += 1) {
-		  array_[idx].abits_val_ = vvp_vector4_t::WORD_X_ABITS;
-		  array_[idx].bbits_val_ = vvp_vector4_t::WORD_X_BBITS;
-	    }
+      page_shift_ = 0;
+      if (array_sparse_words && words_ >= array_sparse_words) {
+	      /* As many words as fit in 4K bytes, but at least one. */
+	    unsigned long fit = 4096 / (cnt_ * sizeof(unsigned long));
+	    while ((2UL << page_shift_) <= fit)
+		  page_shift_ += 1;
       } else {
-	    for (unsigned idx = 0 ; idx < words_ ; idx += 1) {
-		  array_[idx].abits_ptr_ = 0;
-		  array_[idx].bbits_ptr_ = 0;
-	    }
+	      /* One page big enough for all the words. */
+	    while (page_shift_ < 31 && (1UL << page_shift_) < words_)
+		  page_shift_ += 1;
       }
+
+      npages_ = words_? ((words_-1) >> page_shift_) + 1 : 0;
+      pages_ = (struct page_s*)calloc(npages_ + 1, sizeof(struct page_s));
+      assert(pages_);
 }
 
 vvp_vector4array_sa::~vvp_vector4array_sa()
 {
-      if (array_) {
-	    if (width_ > vvp_vector4_t::BITS_PER_WORD) {
-		  for (unsigned idx = 0 ; idx < words_ ; idx += 1)
-			if (array_[idx].abits_ptr_)
-			      delete[]array_[idx].abits_ptr_;
-	    }
-	    delete[]array_;
+      for (unsigned idx = 0 ; idx < npages_ ; idx += 1) {
+	    free(pages_[idx].valid);
+	    free(pages_[idx].bbits);
       }
+      free(pages_);
+}
+
+unsigned vvp_vector4array_sa::page_words_(unsigned idx) const
+{
+      unsigned long first = (unsigned long)idx << page_shift_;
+      unsigned long count = 1UL << page_shift_;
+      if (first + count > words_)
+	    count = words_ - first;
+      return count;
+}
+
+/*
+ * The planes are allocated with calloc, which for big pages gets
+ * fresh memory from the system that only takes up space when the
+ * simulation touches it. The bit map of written words is in the same
+ * block, in front of the abits.
+ */
+void vvp_vector4array_sa::alloc_page_(struct page_s&page, unsigned idx)
+{
+      unsigned nwords = page_words_(idx);
+      unsigned nvalid = nwords / vvp_vector4_t::BITS_PER_WORD + 1;
+
+      page.valid = (unsigned long*)calloc(nvalid + (size_t)nwords * cnt_,
+					  sizeof(unsigned long));
+      assert(page.valid);
+      page.abits = page.valid + nvalid;
+      page.bbits = 0;
+
+      count_add(count_array_pages);
 }
 
 void vvp_vector4array_sa::set_word(unsigned index, const vvp_vector4_t&that)
 {
       assert(index < words_);
+      assert(that.size_ == width_);
 
-      v4cell*cell = &array_[index];
+      unsigned pidx = index >> page_shift_;
+      unsigned off = index & ((1U << page_shift_) - 1);
+      struct page_s&page = pages_[pidx];
 
-      set_word_(cell, that);
+      if (page.valid == 0)
+	    alloc_page_(page, pidx);
+
+      size_t base = (size_t)off * cnt_;
+
+      const unsigned long*abits = cnt_ == 1? &that.abits_val_ : that.abits_ptr_;
+      const unsigned long*bbits = cnt_ == 1? &that.bbits_val_ : that.bbits_ptr_;
+
+      memcpy(page.abits + base, abits, cnt_ * sizeof(unsigned long));
+
+      if (page.bbits == 0) {
+	      /* Still in 2-state mode, so there is nothing to do
+		 unless this word has X or Z bits in it. */
+	    unsigned long xz = 0;
+	    for (unsigned idx = 0 ; idx < cnt_ ; idx += 1)
+		  xz |= bbits[idx];
+
+	    if (xz != 0) {
+		  page.bbits = (unsigned long*)calloc((size_t)page_words_(pidx) * cnt_,
+						      sizeof(unsigned long));
+		  assert(page.bbits);
+	    }
+      }
+
+      if (page.bbits)
+	    memcpy(page.bbits + base, bbits, cnt_ * sizeof(unsigned long));
+
+      page.valid[off / vvp_vector4_t::BITS_PER_WORD]
+	    |= 1UL << (off % vvp_vector4_t::BITS_PER_WORD);
 }
 
 vvp_vector4_t vvp_vector4array_sa::get_word(unsigned index) const
@@ -1818,11 +2228,32 @@ vvp_vector4_t vvp_vector4array_sa::get_word(unsigned index) const
       if (index >= words_)
 	    return vvp_vector4_t(width_, BIT4_X);
 
-      assert(index < words_);
+      unsigned off = index & ((1U << page_shift_) - 1);
+      const struct page_s&page = pages_[index >> page_shift_];
 
-      v4cell*cell = &array_[index];
+      if (page.valid == 0)
+	    return vvp_vector4_t(width_, BIT4_X);
 
-      return get_word_(cell);
+      unsigned long vmask = 1UL << (off % vvp_vector4_t::BITS_PER_WORD);
+      if ((page.valid[off / vvp_vector4_t::BITS_PER_WORD] & vmask) == 0)
+	    return vvp_vector4_t(width_, BIT4_X);
+
+      size_t base = (size_t)off * cnt_;
+
+      if (cnt_ == 1) {
+	    vvp_vector4_t res;
+	    res.size_ = width_;
+	    res.abits_val_ = page.abits[base];
+	    res.bbits_val_ = page.bbits? page.bbits[base] : 0;
+	    return res;
+      }
+
+      vvp_vector4_t res (width_, BIT4_0);
+      memcpy(res.abits_ptr_, page.abits + base, cnt_ * sizeof(unsigned long));
+      if (page.bbits)
+	    memcpy(res.bbits_ptr_, page.bbits + base, cnt_ * sizeof(unsigned long));
+
+      return res;
 }
 
 vvp_vector4array_aa::vvp_vector4array_aa(unsigned width__, unsigned words__)
@@ -2639,14 +3070,38 @@ vvp_vector8_t::vvp_vector8_t(const vvp_vector4_t&that,
       if (size_ == 0)
 	    return;
 
+      unsigned char*dst;
       if (size_ <= sizeof val_) {
 	    ptr_ = 0; // Prefill all val_ bytes
-	    for (unsigned idx = 0 ; idx < size_ ; idx += 1)
-		  val_[idx] = vvp_scalar_t(that.value(idx),str0, str1).raw();
+	    dst = val_;
       } else {
 	    ptr_ = new unsigned char[size_];
-	    for (unsigned idx = 0 ;  idx < size_ ;  idx += 1)
-		  ptr_[idx] = vvp_scalar_t(that.value(idx), str0, str1).raw();
+	    dst = ptr_;
+      }
+
+	/* There are only 4 possible results, so make them once and
+	   index them with the a/b bits of each input bit. */
+      unsigned char tab[4];
+      tab[0] = vvp_scalar_t(BIT4_0, str0, str1).raw();
+      tab[1] = vvp_scalar_t(BIT4_1, str0, str1).raw();
+      tab[2] = vvp_scalar_t(BIT4_Z, str0, str1).raw();
+      tab[3] = vvp_scalar_t(BIT4_X, str0, str1).raw();
+
+      const unsigned long*ap = that.abits_words();
+      const unsigned long*bp = that.bbits_words();
+      const unsigned bpw = 8*sizeof(unsigned long);
+
+      for (unsigned idx = 0 ;  idx < size_ ;  idx += bpw) {
+	    unsigned long a = ap[idx/bpw];
+	    unsigned long b = bp[idx/bpw];
+	    unsigned cnt = size_ - idx;
+	    if (cnt > bpw) cnt = bpw;
+
+	    for (unsigned bdx = 0 ;  bdx < cnt ;  bdx += 1) {
+		  dst[idx+bdx] = tab[(a&1UL) | ((b&1UL)<<1)];
+		  a >>= 1;
+		  b >>= 1;
+	    }
       }
 }
 
@@ -2853,6 +3308,11 @@ void vvp_net_fun_t::force_flag(void)
 {
 }
 
+bool vvp_net_fun_t::local_only(void) const
+{
+      return false;
+}
+
 /* **** vvp_fun_drive methods **** */
 
 vvp_fun_drive::vvp_fun_drive(vvp_bit4_t init, unsigned str0, unsigned str1)
@@ -3178,6 +3638,69 @@ vvp_scalar_t fully_featured_resolv_(vvp_scalar_t a, vvp_scalar_t b)
       return res;
 }
 
+/*
+ * The resolution of every pair of raw vvp_scalar_t values, so that
+ * vector resolution is a table lookup per bit. The table is filled
+ * from the scalar resolve() by a static constructor, so it always
+ * agrees with it and is ready before any thread resolves a net.
+ */
+struct vvp_resolv_table_s {
+      vvp_resolv_table_s();
+      unsigned char res[256][256];
+};
+
+vvp_resolv_table_s::vvp_resolv_table_s()
+{
+      vvp_vector8_t tmp (2);
+      unsigned char*tp = tmp.bytes_();
+      for (unsigned adx = 0 ;  adx < 256 ;  adx += 1) {
+	    for (unsigned bdx = 0 ;  bdx < 256 ;  bdx += 1) {
+		  tp[0] = adx;
+		  tp[1] = bdx;
+		  tmp.set_bit(0, resolve(tmp.value(0), tmp.value(1)));
+		  res[adx][bdx] = tp[0];
+	    }
+      }
+}
+
+static const vvp_resolv_table_s resolv_table;
+
+vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b)
+{
+      assert(a.size() == b.size());
+
+      vvp_vector8_t out (a.size());
+
+      const unsigned char*ap = a.bytes_();
+      const unsigned char*bp = b.bytes_();
+      unsigned char*op = out.bytes_();
+      const unsigned wsize = sizeof(unsigned long);
+
+      unsigned idx = 0;
+	/* A word of bytes at a time, most words of a bus have one
+	   side HiZ (not driven by that driver) or the same on both
+	   sides, and those words are just copied. */
+      for ( ; idx+wsize <= out.size() ;  idx += wsize) {
+	    unsigned long aw, bw;
+	    memcpy(&aw, ap+idx, wsize);
+	    memcpy(&bw, bp+idx, wsize);
+
+	    if (bw == 0 || aw == bw) {
+		  memcpy(op+idx, &aw, wsize);
+	    } else if (aw == 0) {
+		  memcpy(op+idx, &bw, wsize);
+	    } else {
+		  for (unsigned bdx = idx ;  bdx < idx+wsize ;  bdx += 1)
+			op[bdx] = resolv_table.res[ap[bdx]][bp[bdx]];
+	    }
+      }
+
+      for ( ;  idx < out.size() ;  idx += 1)
+	    op[idx] = resolv_table.res[ap[idx]][bp[idx]];
+
+      return out;
+}
+
 vvp_vector8_t resistive_reduction(const vvp_vector8_t&that)
 {
       static unsigned rstr[8] = {
@@ -3207,8 +3730,45 @@ vvp_vector8_t resistive_reduction(const vvp_vector8_t&that)
 vvp_vector4_t reduce4(const vvp_vector8_t&that)
 {
       vvp_vector4_t out (that.size());
-      for (unsigned idx = 0 ;  idx < out.size() ;  idx += 1)
-	    out.set_bit(idx, that.value(idx).value());
+      if (out.size() == 0)
+	    return out;
+
+      const unsigned char*src = that.bytes_();
+      unsigned long*ap = out.abits_words();
+      unsigned long*bp = out.bbits_words();
+      const unsigned bpw = 8*sizeof(unsigned long);
+
+	/* Build the a/b words directly. HiZ is 0x00, and otherwise
+	   the value bits (0x88) select 0, 1 or X. */
+      for (unsigned idx = 0 ;  idx < out.size() ;  idx += bpw) {
+	    unsigned cnt = out.size() - idx;
+	    if (cnt > bpw) cnt = bpw;
+
+	    unsigned long a = 0, b = 0;
+	    for (unsigned bdx = 0 ;  bdx < cnt ;  bdx += 1) {
+		  unsigned char val = src[idx+bdx];
+		  unsigned long mask = 1UL << bdx;
+		  if (val == 0) {
+			b |= mask;
+		  } else switch (val & 0x88) {
+		      case 0x00:
+			break;
+		      case 0x88:
+			a |= mask;
+			break;
+		      default:
+			a |= mask;
+			b |= mask;
+			break;
+		  }
+	    }
+
+	      /* Leave the bits past the end as the constructor made
+		 them. */
+	    unsigned long keep = cnt < bpw? ~0UL << cnt : 0UL;
+	    ap[idx/bpw] = (ap[idx/bpw] & keep) | a;
+	    bp[idx/bpw] = (bp[idx/bpw] & keep) | b;
+      }
 
       return out;
 }
@@ -23,6 +23,7 @@
 # include  "vpi_user.h"
 # include  "vvp_vpi_callback.h"
 # include  "permaheap.h"
+# include  "profile.h"
 # include  <cstddef>
 # include  <cstdlib>
 # include  <cstring>
@@ -214,6 +215,11 @@ class vvp_vector4_t {
       vvp_vector4_t(const vvp_vector4_t&that, bool invert_flag);
       vvp_vector4_t& operator= (const vvp_vector4_t&that);
 
+	// Exchange the contents of this and that. This is cheap even
+	// for wide vectors, and is the way to hand a value that is
+	// no longer needed to a new owner without copying it.
+      void swap(vvp_vector4_t&that);
+
       ~vvp_vector4_t();
 
       unsigned size() const { return size_; }
@@ -256,6 +262,17 @@ class vvp_vector4_t {
 	// Display the value into the buf as a string.
       char*as_string(char*buf, size_t buf_len);
 
+	// Raw views of the abits and bbits words of the vector (see
+	// the encoding below) for code that works a word at a time.
+	// With W bits in an unsigned long, bit idx of the vector is
+	// bit idx%W of word idx/W. The bits past size() in the last
+	// word are don't-care, and writers may leave anything there.
+      unsigned word_count() const;
+      const unsigned long*abits_words() const;
+      const unsigned long*bbits_words() const;
+      unsigned long*abits_words();
+      unsigned long*bbits_words();
+
       void invert();
       vvp_vector4_t& operator &= (const vvp_vector4_t&that);
       vvp_vector4_t& operator |= (const vvp_vector4_t&that);
@@ -291,6 +308,11 @@ class vvp_vector4_t {
 
       void allocate_words_(unsigned size, unsigned long inita, unsigned long initb);
 
+	// Get/release the double-length word array for a vector of
+	// cnt words. Small arrays are recycled through slab heaps.
+      static unsigned long*alloc_words_(unsigned cnt);
+      static void free_words_(unsigned long*ptr, unsigned cnt);
+
 	// Values in the vvp_vector4_t are stored split across two
 	// arrays. For each bit in the vector, there is an abit and a
 	// bbit. the encoding of a vvp_vector4_t is:
@@ -347,7 +369,7 @@ inline vvp_vector4_t::vvp_vector4_t(unsigned size__, vvp_bit4_t val)
 inline vvp_vector4_t::~vvp_vector4_t()
 {
       if (size_ > BITS_PER_WORD) {
-	    delete[] abits_ptr_;
+	    free_words_(abits_ptr_, (size_+BITS_PER_WORD-1) / BITS_PER_WORD);
 	      // bbits_ptr_ actually points half-way into a
 	      // double-length array started at abits_ptr_
       }
@@ -358,8 +380,15 @@ inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
       if (this == &that)
 	    return *this;
 
+	// Assigning a wide value of the same size is common (think
+	// of signals being updated) so reuse the existing array.
+      if (size_ == that.size_ && size_ > BITS_PER_WORD) {
+	    copy_bits(that);
+	    return *this;
+      }
+
       if (size_ > BITS_PER_WORD)
-	    delete[] abits_ptr_;
+	    free_words_(abits_ptr_, (size_+BITS_PER_WORD-1) / BITS_PER_WORD);
 
       copy_from_(that);
 
@@ -367,6 +396,41 @@ inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
 }
 
 
+inline void vvp_vector4_t::swap(vvp_vector4_t&that)
+{
+	// The words are in unions, so move whichever member is live
+	// for each of the vectors.
+      unsigned long*tmp_aptr = 0, *tmp_bptr = 0;
+      unsigned long tmp_aval = 0, tmp_bval = 0;
+      if (size_ > BITS_PER_WORD) {
+	    tmp_aptr = abits_ptr_;
+	    tmp_bptr = bbits_ptr_;
+      } else {
+	    tmp_aval = abits_val_;
+	    tmp_bval = bbits_val_;
+      }
+
+      if (that.size_ > BITS_PER_WORD) {
+	    abits_ptr_ = that.abits_ptr_;
+	    bbits_ptr_ = that.bbits_ptr_;
+      } else {
+	    abits_val_ = that.abits_val_;
+	    bbits_val_ = that.bbits_val_;
+      }
+
+      if (size_ > BITS_PER_WORD) {
+	    that.abits_ptr_ = tmp_aptr;
+	    that.bbits_ptr_ = tmp_bptr;
+      } else {
+	    that.abits_val_ = tmp_aval;
+	    that.bbits_val_ = tmp_bval;
+      }
+
+      unsigned tmp_size = size_;
+      size_ = that.size_;
+      that.size_ = tmp_size;
+}
+
 inline vvp_bit4_t vvp_vector4_t::value(unsigned idx) const
 {
       if (idx >= size_)
@@ -404,6 +468,31 @@ inline vvp_vector4_t vvp_vector4_t::subvalue(unsigned adr, unsigned wid) const
       return vvp_vector4_t(*this, adr, wid);
 }
 
+inline unsigned vvp_vector4_t::word_count() const
+{
+      return (size_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+inline const unsigned long* vvp_vector4_t::abits_words() const
+{
+      return size_ > BITS_PER_WORD? abits_ptr_ : &abits_val_;
+}
+
+inline const unsigned long* vvp_vector4_t::bbits_words() const
+{
+      return size_ > BITS_PER_WORD? bbits_ptr_ : &bbits_val_;
+}
+
+inline unsigned long* vvp_vector4_t::abits_words()
+{
+      return size_ > BITS_PER_WORD? abits_ptr_ : &abits_val_;
+}
+
+inline unsigned long* vvp_vector4_t::bbits_words()
+{
+      return size_ > BITS_PER_WORD? bbits_ptr_ : &bbits_val_;
+}
+
 inline void vvp_vector4_t::set_bit(unsigned idx, vvp_bit4_t val)
 {
       assert(idx < size_);
@@ -492,6 +581,15 @@ extern bool vector4_to_value(const vvp_vector4_t&a, vvp_time64_t&val);
 #endif
 extern bool vector4_to_value(const vvp_vector4_t&a, double&val, bool is_signed);
 
+/*
+ * Arrays with at least this many words are stored sparsely: the
+ * storage is split into pages of about 4K bytes, and each page is
+ * only allocated when a word in it is first written. Untouched words
+ * read as the default value (X, or 0.0 for real arrays). Zero turns
+ * this off. (vvp -A)
+ */
+extern unsigned long array_sparse_words;
+
 /*
  * The __vpiArray handle uses instances of this to keep an array of
  * real valued variables.
@@ -508,8 +606,12 @@ class vvp_realarray_t {
       void set_word(unsigned idx, double val);
 
     private:
+      enum { PAGE_SHIFT = 9 };
+
       unsigned words_;
+	// A dense array is kept in array_, and a sparse array in pages_.
       double*array_;
+      double**pages_;
 };
 
 /*
@@ -552,6 +654,19 @@ class vvp_vector4array_t {
 
 /*
  * Statically allocated vvp_vector4array_t
+ *
+ * The words are packed end to end in pages, each with an abits
+ * plane, a bbits plane and a bit map of the words that have been
+ * written; the others read as X. This way a big memory costs only
+ * its payload and not an allocation per word. A page is not
+ * allocated until a word in it is first written. Dense arrays have a
+ * single page that holds all the words, and sparse arrays (see
+ * array_sparse_words) have pages of about 4K bytes.
+ *
+ * Most memories never hold an X or Z value in a word that was
+ * written, so the bbits plane of a page is not allocated (and all
+ * the words written in it are taken to be 2-state) until the first
+ * write of a word that has X or Z bits.
  */
 class vvp_vector4array_sa : public vvp_vector4array_t {
 
@@ -563,7 +678,19 @@ class vvp_vector4array_sa : public vvp_vector4array_t {
       void set_word(unsigned idx, const vvp_vector4_t&that);
 
     private:
-      v4cell* array_;
+      struct page_s {
+	    unsigned long*valid;
+	    unsigned long*abits;
+	    unsigned long*bbits;
+      };
+
+      void alloc_page_(struct page_s&page, unsigned idx);
+      unsigned page_words_(unsigned idx) const;
+
+      unsigned cnt_;
+      unsigned page_shift_;
+      unsigned npages_;
+      struct page_s*pages_;
 };
 
 /*
@@ -802,6 +929,9 @@ extern ostream& operator<< (ostream&, vvp_scalar_t);
 class vvp_vector8_t {
 
       friend vvp_vector8_t part_expand(const vvp_vector8_t&, unsigned, unsigned);
+      friend vvp_vector8_t resolve(const vvp_vector8_t&, const vvp_vector8_t&);
+      friend struct vvp_resolv_table_s;
+      friend vvp_vector4_t reduce4(const vvp_vector8_t&);
 
     public:
       explicit vvp_vector8_t(unsigned size =0);
@@ -829,6 +959,14 @@ class vvp_vector8_t {
       vvp_vector8_t(const vvp_vector8_t&that);
       vvp_vector8_t& operator= (const vvp_vector8_t&that);
 
+    private:
+	// The raw vvp_scalar_t encodings, one byte per bit, wherever
+	// they happen to be kept.
+      const unsigned char*bytes_() const
+	    { return size_ <= sizeof val_? val_ : ptr_; }
+      unsigned char*bytes_()
+	    { return size_ <= sizeof val_? val_ : ptr_; }
+
     private:
 	// This is the number of vvp_scalar_t objects we can keep in
 	// the val_ buffer. If the vector8 is bigger then this, then
@@ -841,18 +979,11 @@ class vvp_vector8_t {
 };
 
   /* Resolve uses the default Verilog resolver algorithm to resolve
-     two drive vectors to a single output. */
-inline vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b)
-{
-      assert(a.size() == b.size());
-      vvp_vector8_t out (a.size());
-
-      for (unsigned idx = 0 ;  idx < out.size() ;  idx += 1) {
-	    out.set_bit(idx, resolve(a.value(idx), b.value(idx)));
-      }
-
-      return out;
-}
+     two drive vectors to a single output. It gives the same result
+     as resolving the vvp_scalar_t values bit by bit, but works from
+     a table of all the scalar pairs, and skips whole words of bits
+     where one side is HiZ or the sides are the same. */
+extern vvp_vector8_t resolve(const vvp_vector8_t&a, const vvp_vector8_t&b);
 
   /* This function implements the strength reduction implied by
      Verilog standard resistive devices. */
@@ -1038,6 +1169,34 @@ class vvp_net_t {
 			unsigned base, unsigned wid, unsigned vwid);
 
 
+	// Give this functor net a vvp_net_cache_t filter, so that
+	// resending the last output value goes no further.
+      void cache_output();
+
+    public:
+	// Count the regions of nets that are connected through their
+	// fan-out links, and the number of nets in the largest one.
+      static void count_partitions(unsigned long&count,
+				   unsigned long&largest);
+
+	// Number the local partitions for the scheduler. A partition
+	// is local if every functor in it is local_only() and no net
+	// in it has VPI callbacks, so that propagating through it
+	// touches nothing outside it. Linking or unlinking nets and
+	// adding VPI callbacks set partitions_stale, and then the
+	// partitions must be numbered again before local_partition()
+	// is used. Local partitions count from 1.
+      static unsigned long number_partitions(void);
+      static bool partitions_stale;
+	// The number of the local partition of this net, or 0 if the
+	// net is not in a local partition.
+      unsigned long local_partition(void) const;
+
+    private:
+	// Fill the parent array (one entry per net) with the union-find
+	// of all the nets.
+      static void partition_nets_(unsigned long*parent);
+
     public: // Methods to arrange for the output of this net to be forced.
 
 	// The intent is that all efforts at force are directed to
@@ -1120,6 +1279,12 @@ class vvp_net_fun_t {
 	// do something about it.
       virtual void force_flag(void);
 
+	// This is true for functors that touch nothing but their own
+	// state, the nets of their fan-out and schedule_functor().
+	// The scheduler may run the local partitions made of such
+	// functors on several threads (see schedule_threads).
+      virtual bool local_only(void) const;
+
     public: // These objects are only permallocated.
       static void* operator new(std::size_t size) { return heap_.alloc(size); }
       static void operator delete(void*); // not implemented
@@ -1242,6 +1407,42 @@ class vvp_net_fil_t  : public vvp_vpi_callback {
       struct vvp_net_t*force_link_;
 };
 
+/*
+ * This filter is for the nets of functors (never signals) that send
+ * their whole output whenever any input arrives, even if the output
+ * is the same as last time. It remembers the last vec4 value that
+ * the functor sent, and stops a send of exactly the same value, so
+ * the wave stops at the source instead of at the next signal. Part
+ * sends and vec8 sends are passed, and make it forget the value.
+ *
+ * The compile functions of functor types that benefit attach it with
+ * vvp_net_t::cache_output().
+ */
+class vvp_net_cache_t  : public vvp_net_fil_t {
+
+    public:
+      vvp_net_cache_t();
+      ~vvp_net_cache_t();
+
+      prop_t filter_vec4(const vvp_vector4_t&bit, vvp_vector4_t&rep,
+			 unsigned base, unsigned vwid);
+      prop_t filter_vec8(const vvp_vector8_t&val, vvp_vector8_t&rep,
+			 unsigned base, unsigned vwid);
+
+	// These are never forced, and have no vpi handles.
+      void release(vvp_net_ptr_t ptr, bool net_flag);
+      void release_pv(vvp_net_ptr_t ptr, unsigned base, unsigned wid, bool net_flag);
+      unsigned filter_size() const;
+      void force_fil_vec4(const vvp_vector4_t&val, vvp_vector2_t mask);
+      void force_fil_vec8(const vvp_vector8_t&val, vvp_vector2_t mask);
+      void force_fil_real(double val, vvp_vector2_t mask);
+      void get_value(struct t_vpi_value*value);
+
+    private:
+      bool valid_;
+      vvp_vector4_t val_;
+};
+
 /* **** Some core net functions **** */
 
 /* vvp_fun_concat
@@ -1268,6 +1469,8 @@ class vvp_fun_concat  : public vvp_net_fun_t {
       void recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 			unsigned base, unsigned wid, unsigned vwid,
                         vvp_context_t);
+      bool local_only(void) const { return true; }
+
     private:
       unsigned wid_[4];
       vvp_vector4_t val_;
@@ -1308,6 +1511,7 @@ class vvp_fun_repeat  : public vvp_net_fun_t {
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
+      bool local_only(void) const { return true; }
 
     private:
       unsigned wid_;
@@ -1354,6 +1558,7 @@ class vvp_fun_extend_signed  : public vvp_net_fun_t {
 
       void recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
                      vvp_context_t context);
+      bool local_only(void) const { return true; }
 
     private:
       unsigned width_;
@@ -1447,8 +1652,11 @@ inline void vvp_send_vec4(vvp_net_ptr_t ptr, const vvp_vector4_t&val, vvp_contex
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_vec4(ptr, val, context);
+	    }
 
 	    ptr = next;
       }
@@ -1487,8 +1695,11 @@ inline void vvp_send_vec4_pv(vvp_net_ptr_t ptr, const vvp_vector4_t&val,
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_vec4_pv(ptr, val, base, wid, vwid, context);
+	    }
 
 	    ptr = next;
       }
@@ -1501,8 +1712,11 @@ inline void vvp_net_t::send_vec8_pv(const vvp_vector8_t&val,
       while (struct vvp_net_t*cur = ptr.ptr()) {
 	    vvp_net_ptr_t next = cur->port[ptr.port()];
 
-	    if (cur->fun)
+	    if (cur->fun) {
+		  profile_enter_t prof (profile_active?
+					profile_functor(cur->fun) : 0);
 		  cur->fun->recv_vec8_pv(ptr, val, base, wid, vwid);
+	    }
 
 	    ptr = next;
       }
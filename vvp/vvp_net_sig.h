@@ -151,6 +151,8 @@ class vvp_fun_signal4_sa : public vvp_fun_signal_vec {
 	// Get information about the vector value.
       const vvp_vector4_t& vec4_unfiltered_value() const;
 
+      bool local_only(void) const { return true; }
+
     private:
       vvp_vector4_t bits4_;
 };
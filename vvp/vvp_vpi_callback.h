@@ -39,6 +39,10 @@ class vvp_vpi_callback {
       void attach_as_word(class __vpiArray* arr, unsigned long addr);
 
       void add_vpi_callback(struct __vpiCallback*);
+	// True if anything is called when the value changes. This
+	// includes being a word of an array, which may be watched.
+      bool has_vpi_callbacks(void) const
+      { return vpi_callbacks_ != 0 || array_ != 0; }
 #ifdef CHECK_WITH_VALGRIND
 	/* This has only been tested at EOS. */
       void clear_all_callbacks(void);